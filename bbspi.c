@@ -0,0 +1,227 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * Bitbang SPI master on any P1/P2 pins, for boards where USI pins are
+ * taken and parts without USI. It always runs as fast as it can: each
+ * bit is a fixed, branch-light instruction sequence, unrolled for all 8
+ * bits of a byte. MSB first only.
+ */
+#include "common.h"
+#include "bbspi.h"
+#include "uart.h"
+#include "stats.h"
+
+#if CONFIG_BBSPI
+
+// Same wiring as USI SPI by default
+uint8_t bbspi_pins[BB_PINS] = {0x15, 0x16, 0x17, 0x14};
+uint8_t bbspi_mode;
+
+static BOOL active;
+static volatile uint8_t *sclk_out, *mosi_out, *cs_out;
+static const volatile uint8_t *miso_in;
+static uint8_t sclk_mask, mosi_mask, miso_mask, cs_mask;
+
+// PxIN, PxOUT and PxDIR are at consecutive addresses
+static volatile uint8_t *pin_port(uint8_t pin)
+{
+    return (pin >> 4) == 1 ? &P1IN : &P2IN;
+}
+
+static uint8_t pin_mask(uint8_t pin)
+{
+    return 1 << (pin & 7);
+}
+
+// Any P1/P2 pin but UART ones
+BOOL bbspi_pin_ok(uint8_t pin)
+{
+    uint8_t port = pin >> 4;
+
+    if ((port != 1 && port != 2) || (pin & 0x0F) > 7)
+        return FALSE;
+    if (port == 1 && (pin_mask(pin) & (TXD | RXD)))
+        return FALSE;
+    return TRUE;
+}
+
+/*
+ * One bit, MSB first. CPHA=0: data is set up before leading clock edge
+ * and sampled on it; CPHA=1: data changes on leading edge and is sampled
+ * on trailing one. Edges are toggles, so CPOL is just the idle level.
+ * With everything in registers a bit is ~24 MCLK cycles (bit/jz/bis or
+ * bic/jmp, 2x xor to memory, bit/jz/bis), so ~200 cycles per byte, i.e.
+ * SCLK around MCLK/25 and ~80KB/s at 16MHz. "bench" measures it.
+ */
+#define BIT_CPHA0(b)                        \
+    if (c & (b))                            \
+        *mo |= mosi;                        \
+    else                                    \
+        *mo &= ~mosi;                       \
+    *so ^= sclk;                            \
+    if (*mi & miso)                         \
+        r |= (b);                           \
+    *so ^= sclk;
+
+#define BIT_CPHA1(b)                        \
+    *so ^= sclk;                            \
+    if (c & (b))                            \
+        *mo |= mosi;                        \
+    else                                    \
+        *mo &= ~mosi;                       \
+    *so ^= sclk;                            \
+    if (*mi & miso)                         \
+        r |= (b);
+
+// Everything is kept in registers during the transfer
+#define XACT_LOCALS                         \
+    volatile uint8_t *so = sclk_out;        \
+    volatile uint8_t *mo = mosi_out;        \
+    const volatile uint8_t *mi = miso_in;   \
+    uint8_t sclk = sclk_mask;               \
+    uint8_t mosi = mosi_mask;               \
+    uint8_t miso = miso_mask;               \
+    uint8_t r = 0;
+
+static uint8_t bbspi_xact_cpha0(uint8_t c)
+{
+    XACT_LOCALS
+
+    BIT_CPHA0(0x80) BIT_CPHA0(0x40) BIT_CPHA0(0x20) BIT_CPHA0(0x10)
+    BIT_CPHA0(0x08) BIT_CPHA0(0x04) BIT_CPHA0(0x02) BIT_CPHA0(0x01)
+#if CONFIG_STATS
+    stats.bus_bytes[BUS_BBSPI]++;
+#endif
+    return r;
+}
+
+static uint8_t bbspi_xact_cpha1(uint8_t c)
+{
+    XACT_LOCALS
+
+    BIT_CPHA1(0x80) BIT_CPHA1(0x40) BIT_CPHA1(0x20) BIT_CPHA1(0x10)
+    BIT_CPHA1(0x08) BIT_CPHA1(0x04) BIT_CPHA1(0x02) BIT_CPHA1(0x01)
+#if CONFIG_STATS
+    stats.bus_bytes[BUS_BBSPI]++;
+#endif
+    return r;
+}
+
+// Configure pins for output at given level
+static volatile uint8_t *pin_output(uint8_t pin, BOOL high)
+{
+    volatile uint8_t *port = pin_port(pin);
+    uint8_t mask = pin_mask(pin);
+
+    if (high)
+        port[1] |= mask;
+    else
+        port[1] &= ~mask;
+    port[2] |= mask;
+    return port + 1;
+}
+
+static void apply(void)
+{
+    volatile uint8_t *port;
+
+    sclk_mask = pin_mask(bbspi_pins[BB_SCLK]);
+    mosi_mask = pin_mask(bbspi_pins[BB_MOSI]);
+    miso_mask = pin_mask(bbspi_pins[BB_MISO]);
+    cs_mask = pin_mask(bbspi_pins[BB_CS]);
+
+    cs_out = pin_output(bbspi_pins[BB_CS], TRUE);
+    sclk_out = pin_output(bbspi_pins[BB_SCLK], bbspi_mode & 2);
+    mosi_out = pin_output(bbspi_pins[BB_MOSI], FALSE);
+    port = pin_port(bbspi_pins[BB_MISO]);
+    port[2] &= ~miso_mask;
+    miso_in = port;
+
+    bbspi_bus.xact = (bbspi_mode & 1) ? bbspi_xact_cpha1 : bbspi_xact_cpha0;
+}
+
+// Make pins of current assignment inputs, except ones in keep
+static void release(const uint8_t *keep)
+{
+    uint8_t i, j;
+
+    for (i = 0; i < BB_PINS; i++) {
+        for (j = 0; keep && j < BB_PINS; j++) {
+            if (keep[j] == bbspi_pins[i])
+                break;
+        }
+        if (!keep || j == BB_PINS)
+            pin_port(bbspi_pins[i])[2] &= ~pin_mask(bbspi_pins[i]);
+    }
+}
+
+/*
+ * Take new pin assignment (each pin in one role only, see bbspi_pin_ok())
+ * and mode. If the bus is in use, pins it no longer uses are released
+ * first, so no old output is left driving.
+ */
+BOOL bbspi_configure(const uint8_t *pins, uint8_t mode)
+{
+    uint8_t i, j;
+
+    for (i = 0; i < BB_PINS; i++) {
+        for (j = i + 1; j < BB_PINS; j++) {
+            if (pins[i] == pins[j])
+                return FALSE;
+        }
+    }
+    if (active)
+        release(pins);
+    for (i = 0; i < BB_PINS; i++)
+        bbspi_pins[i] = pins[i];
+    bbspi_mode = mode;
+    if (active)
+        apply();
+    return TRUE;
+}
+
+static void bbspi_init(void)
+{
+    active = TRUE;
+    apply();
+}
+
+static void bbspi_exit(void)
+{
+    active = FALSE;
+    release(NULL);
+}
+
+static void bbspi_cs_assert(void)
+{
+    *cs_out &= ~cs_mask;
+}
+
+static void bbspi_cs_deassert(void)
+{
+    *cs_out |= cs_mask;
+}
+
+struct Bus bbspi_bus = {
+    .prompt = "BBSPI",
+    .init = bbspi_init,
+    .exit = bbspi_exit,
+    .start = bbspi_cs_assert,
+    .stop = bbspi_cs_deassert,
+    .xact = bbspi_xact_cpha0,
+};
+
+#endif
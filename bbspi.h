@@ -0,0 +1,33 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef BBSPI_H
+#define BBSPI_H 1
+
+#include "common.h"
+#include "bus.h"
+
+extern struct Bus bbspi_bus;
+
+// Pins are (port << 4) | bit, e.g. 0x15 is P1.5
+enum {BB_SCLK, BB_MOSI, BB_MISO, BB_CS, BB_PINS};
+extern uint8_t bbspi_pins[BB_PINS];
+// (CPOL << 1) | CPHA
+extern uint8_t bbspi_mode;
+
+BOOL bbspi_pin_ok(uint8_t pin);
+BOOL bbspi_configure(const uint8_t *pins, uint8_t mode);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * Bus Pirate compatible binary mode, see
+ * http://dangerousprototypes.com/docs/Bitbang and
+ * http://dangerousprototypes.com/docs/SPI_(binary)
+ * Only raw SPI mode is implemented, which is what flashrom and similar
+ * host tools use. Every SPI byte costs exactly one UART byte each way.
+ * Speeds are rounded down to what SMCLK dividers allow.
+ */
+#include "common.h"
+#include "binmode.h"
+#include "console.h"
+#include "uart.h"
+#include "spi.h"
+
+#if CONFIG_BINMODE
+
+#define BP_MAX_XFER 4096
+
+#if CONFIG_SPI_CONFIG
+// SCLK for speed command (0110xxxx)
+static const uint32_t bp_speeds[] = {
+    30000, 125000, 250000, 1000000, 2000000, 2600000, 4000000, 8000000
+};
+#endif
+
+static uint8_t getc_wait(void)
+{
+    uint8_t c;
+    while (!uart_getc(&c));
+    return c;
+}
+
+static uint16_t getw_wait(void)
+{
+    uint16_t w = getc_wait() << 8;
+    return w | getc_wait();
+}
+
+// 0x04/0x05: write wlen bytes, then read rlen bytes
+static void write_then_read(BOOL use_cs)
+{
+    uint16_t wlen = getw_wait();
+    uint16_t rlen = getw_wait();
+
+    if (wlen > BP_MAX_XFER || rlen > BP_MAX_XFER) {
+        console_putc(0x00);
+        return;
+    }
+
+    if (use_cs)
+        spi_bus.start();
+    // Data is clocked out as it arrives, reply only after all of it
+    // is received (soft UART is half-duplex).
+    while (wlen--)
+        spi_bus.xact(getc_wait());
+    console_putc(0x01);
+    while (rlen--)
+        console_putc(spi_bus.xact(0xFF));
+    if (use_cs)
+        spi_bus.stop();
+}
+
+// 0001xxxx: transfer xxxx+1 bytes
+static void bulk_transfer(uint8_t cmd)
+{
+    uint8_t buf[16];
+    uint8_t n = (cmd & 0x0F) + 1;
+    uint8_t i;
+
+    for (i = 0; i < n; i++)
+        buf[i] = getc_wait();
+    console_putc(0x01);
+    for (i = 0; i < n; i++)
+        console_putc(spi_bus.xact(buf[i]));
+}
+
+static void raw_spi_mode(void)
+{
+    uint8_t cmd;
+
+    spi_bus.init();
+    spi_bus.stop();
+    console_puts("SPI1");
+
+    while (1) {
+        cmd = getc_wait();
+        switch (cmd >> 4) {
+        case 0x0:
+            switch (cmd) {
+            case 0x00:
+                spi_bus.exit();
+                return;
+            case 0x01:
+                console_puts("SPI1");
+                break;
+            case 0x02:
+                spi_bus.start();
+                console_putc(0x01);
+                break;
+            case 0x03:
+                spi_bus.stop();
+                console_putc(0x01);
+                break;
+            case 0x04:
+            case 0x05:
+                write_then_read(cmd == 0x04);
+                break;
+            default:
+                console_putc(0x00);
+            }
+            break;
+        case 0x1:
+            bulk_transfer(cmd);
+            break;
+#if CONFIG_SPI_CONFIG
+        case 0x6: // speed
+            spi_speed = bp_speeds[cmd & 7];
+            spi_configure();
+            console_putc(0x01);
+            break;
+        case 0x8: // SPI config: 1000wxyz, x - CKP, y - CKE, w/z ignored
+            // CKE=1 (change on active to idle edge) means CPHA=0
+            spi_mode = ((cmd & 0x04) ? 2 : 0) | ((cmd & 0x02) ? 0 : 1);
+            spi_configure();
+            console_putc(0x01);
+            break;
+#else
+        case 0x6: // speed
+        case 0x8: // SPI config
+#endif
+        case 0x4: // peripherals (power, pull-ups, AUX, CS)
+            // Nothing to configure on Launchpad, just acknowledge
+            console_putc(0x01);
+            break;
+        default:
+            console_putc(0x00);
+        }
+    }
+}
+
+// Bitbang (BBIO) mode, entry point of the binary protocol. Returns
+// on reset command (0x0F), after which the console takes over again.
+void binmode_run(void)
+{
+    uint8_t cmd;
+
+    console_puts("BBIO1");
+    while (1) {
+        cmd = getc_wait();
+        switch (cmd) {
+        case 0x00:
+            console_puts("BBIO1");
+            break;
+        case 0x01:
+            raw_spi_mode();
+            console_puts("BBIO1");
+            break;
+        case 0x0F:
+            console_putc(0x01);
+            return;
+        }
+    }
+}
+
+#endif
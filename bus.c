@@ -0,0 +1,45 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#include "common.h"
+#include "bus.h"
+#include "cpu.h"
+
+/*
+ * Clock bytes (0xFF) through the bus until (byte & mask) == value or
+ * timeout_ms expires, e.g. to wait for a status register bit. Bus
+ * transaction (CS, command) must be set up by caller. Returns TRUE if
+ * condition was met, details are stored in *res.
+ */
+BOOL bus_poll(struct Bus *bus, uint8_t mask, uint8_t value,
+              uint16_t timeout_ms, struct BusPoll *res)
+{
+    uint32_t limit = timeout_ms * (cpu_hz / 1000);
+    uint16_t last = cpu_ticks(), now;
+
+    res->count = 0;
+    res->ticks = 0;
+    while (1) {
+        res->value = bus_read(bus);
+        res->count++;
+        if ((res->value & mask) == value)
+            return TRUE;
+        now = cpu_ticks();
+        res->ticks += (uint16_t)(now - last);
+        last = now;
+        if (res->ticks >= limit)
+            return FALSE;
+    }
+}
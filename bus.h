@@ -8,6 +8,27 @@ struct Bus {
     void (*start)();
     void (*stop)();
     uint8_t (*xact)(uint8_t);
+    // Optional read, for buses where it's not the same as writing 0xFF
+    uint8_t (*read)(void);
+    // Optional 1-16 bit transfers, data is right-aligned
+    uint16_t (*xact_bits)(uint16_t data, uint8_t bits);
+    uint16_t widths;    // bit n-1 is set if n bit transfers are supported
+    // Optional main loop hook, run on EV_BUS event
+    void (*tick)(void);
 };
 
+static inline uint8_t bus_read(struct Bus *bus)
+{
+    return bus->read ? bus->read() : bus->xact(0xFF);
+}
+
+struct BusPoll {
+    uint8_t value;      // last byte read
+    uint32_t count;     // number of bytes clocked
+    uint32_t ticks;     // SMCLK cycles spent
+};
+
+BOOL bus_poll(struct Bus *bus, uint8_t mask, uint8_t value,
+              uint16_t timeout_ms, struct BusPoll *res);
+
 #endif
@@ -0,0 +1,332 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * Simple logic analyser: sample a port at fixed rate into RAM, then
+ * upload samples run-length encoded, so idle stretches cost almost
+ * nothing on the UART. Sampling is paced by Timer_A counter (both of its
+ * CCRs belong to soft UART on small parts) with interrupts disabled, so
+ * there's no jitter from the UART ISRs.
+ *
+ * Edge capture records pin changes in the background instead, from port
+ * pin-change interrupts, with Timer_A timestamps (Timer_A capture inputs
+ * are taken by soft UART RX or sit on UART pins), for sparse signals
+ * like IR or 1-wire, over long windows.
+ */
+#include "common.h"
+#include "capture.h"
+#include "console.h"
+#include "cpu.h"
+#include "uart.h"
+#include "event.h"
+#include "spi.h"
+#include "sniff.h"
+
+#if CONFIG_CAPTURE || CONFIG_EDGES
+
+// Pin state and 32-bit timestamp: Timer_A extended with its overflow
+// count, as cpu_ticks32(). 8 bits of overflows would only last about a
+// second at 16MHz.
+struct Edge {
+    uint16_t lo;
+    uint16_t hi;
+    uint8_t state;
+};
+
+// Not a power of 2, so ring indexes wrap explicitly
+#define EDGES_SIZ (CAPTURE_BUF_SIZ / sizeof(struct Edge))
+
+// Samples and edges share RAM
+static union {
+    uint8_t samples[CAPTURE_BUF_SIZ];
+    struct Edge edges[EDGES_SIZ];
+} buf;
+#define capture_buf buf.samples
+
+#endif
+
+#if CONFIG_EDGES
+
+static volatile uint8_t *edge_port; // PxIN of watched port, NULL if off
+static uint8_t edge_mask;
+// One entry is left free, so head == tail means empty
+static volatile uint8_t edge_head, edge_tail;
+static volatile uint16_t edges_lost;
+static uint32_t edge_last; // timestamp of last edge dumped
+
+// PxIN, PxOUT, PxDIR, PxIFG, PxIES, PxIE are at consecutive addresses
+#define PORT_IFG(p) (p)[3]
+#define PORT_IES(p) (p)[4]
+#define PORT_IE(p)  (p)[5]
+
+static uint8_t edge_next(uint8_t i)
+{
+    return i + 1 == EDGES_SIZ ? 0 : i + 1;
+}
+
+static void edge_put(uint8_t state)
+{
+    struct Edge *e;
+    uint16_t lo = cpu_ticks();
+    uint16_t hi = cpu_ticks_hi;
+    uint8_t next = edge_next(edge_head);
+
+    // Overflow happened, but isn't counted yet
+    if ((TACTL & TAIFG) && lo < 0x8000)
+        hi++;
+
+    if (next == edge_tail) {
+        edges_lost++;
+        return;
+    }
+    e = &buf.edges[edge_head];
+    e->lo = lo;
+    e->hi = hi;
+    e->state = state;
+    edge_head = next;
+}
+
+// Record state, and wait for next edge of each pin, the opposite one
+static void edge_record(volatile uint8_t *port)
+{
+    uint8_t state = port[0];
+
+    edge_put(state & edge_mask);
+    PORT_IES(port) = (PORT_IES(port) & ~edge_mask) | (state & edge_mask);
+    // Clear flags, but come back if pins changed meanwhile. Other pins
+    // of the port may have their own users.
+    PORT_IFG(port) &= ~edge_mask;
+    PORT_IFG(port) |= (port[0] ^ state) & edge_mask;
+}
+
+// Pin-change interrupt handler for port (PxIN), see main.c
+void edges_irq(volatile uint8_t *port)
+{
+    if (port == edge_port && (PORT_IFG(port) & edge_mask))
+        edge_record(port);
+}
+
+// Stop watching pins of port, for their new owner
+void edges_drop(volatile uint8_t *port, uint8_t mask)
+{
+    if (port == edge_port) {
+        PORT_IE(port) &= ~mask;
+        edge_mask &= ~mask;
+    }
+}
+
+void edges_stop(void)
+{
+    if (edge_port) {
+        PORT_IE(edge_port) &= ~edge_mask;
+        PORT_IFG(edge_port) &= ~edge_mask;
+    }
+    edge_port = NULL;
+}
+
+// Start recording edges of masked pins of port (PxIN), with initial
+// state as first entry
+void edges_start(volatile uint8_t *port, uint8_t mask)
+{
+    // UART has its own interrupts, and so has sniffer CS
+    if (port == &P1IN) {
+        mask &= ~(TXD | RXD);
+#if CONFIG_SNIFF
+        if (sniff_active)
+            mask &= ~CS;
+#endif
+    }
+
+    dint();
+    edges_stop();
+    edge_head = edge_tail = 0;
+    edges_lost = 0;
+    edge_port = port;
+    edge_mask = mask;
+    edge_record(port);
+    edge_last = (uint32_t)buf.edges[0].hi << 16 | buf.edges[0].lo;
+    PORT_IE(port) |= mask;
+    eint();
+}
+
+/*
+ * Output and remove recorded edges as "<state>:<cycles since previous
+ * one>" pairs (hex/decimal), 8 per line, or state byte and 32-bit delta
+ * (big endian) in raw format. First delta of a recording is 0. Deltas
+ * are modulo 2^32 cycles, about 4.5 minutes at 16MHz.
+ */
+void edges_dump(void)
+{
+    const struct Edge *e;
+    uint32_t t, dt;
+    uint8_t n = edge_head - edge_tail, col = 0;
+
+    if (edge_head < edge_tail)
+        n += EDGES_SIZ;
+
+    if (console_out != OUT_RAW) {
+        console_puts("EDGES: ");
+        console_putdec(n);
+        console_puts(" LOST: ");
+        console_putdec(edges_lost);
+        console_puts(" @ ");
+        console_putdec(cpu_hz);
+        console_puts(" Hz");
+        console_newline();
+    }
+    edges_lost = 0;
+
+    while (n--) {
+        e = &buf.edges[edge_tail];
+        t = (uint32_t)e->hi << 16 | e->lo;
+        dt = t - edge_last;
+        edge_last = t;
+        if (console_out == OUT_RAW) {
+            console_putc(e->state);
+            console_putc(dt >> 24);
+            console_putc(dt >> 16);
+            console_putc(dt >> 8);
+            console_putc(dt);
+        } else {
+            console_puthex8(e->state);
+            console_putc(':');
+            console_putudec(dt);
+            if (++col == 8 || !n) {
+                console_newline();
+                col = 0;
+            } else {
+                console_putc(' ');
+            }
+        }
+        edge_tail = edge_next(edge_tail);
+    }
+}
+
+#endif
+
+#if CONFIG_CAPTURE
+
+// Shortest sample period (in SMCLK cycles) the sampling loop keeps up with
+#define MIN_PERIOD 16
+
+// Wait for trigger edge, FALSE if aborted by UART input
+static BOOL wait_trigger(const struct Capture *c)
+{
+    uint8_t prev = *c->trig_port & c->trig_mask, now;
+
+    while (!(events & EV_UART_RX)) {
+        now = *c->trig_port & c->trig_mask;
+        if (now != prev && (now != 0) == c->trig_rise)
+            return TRUE;
+        prev = now;
+    }
+    return FALSE;
+}
+
+/*
+ * Upload samples as runs: "<hex value>:<count>" in text formats, 8 per
+ * line, or <value> <count> byte pairs (count 1-255) in raw format.
+ */
+static void upload(const struct Capture *c)
+{
+    const uint8_t *p = capture_buf, *end = capture_buf + c->count;
+    uint16_t n;
+    uint8_t v, col = 0;
+
+    while (p < end) {
+        v = *p & c->mask;
+        n = 0;
+        while (p < end && (*p & c->mask) == v) {
+            if (console_out == OUT_RAW && n == 255)
+                break;
+            p++;
+            n++;
+        }
+        if (console_out == OUT_RAW) {
+            console_putc(v);
+            console_putc(n);
+            continue;
+        }
+        console_puthex8(v);
+        console_putc(':');
+        console_putdec(n);
+        if (++col == 8 || p == end) {
+            console_newline();
+            col = 0;
+        } else {
+            console_putc(' ');
+        }
+    }
+}
+
+/*
+ * Capture c->count samples (up to CAPTURE_BUF_SIZ) and upload them.
+ * FALSE if rate can't be done.
+ */
+BOOL capture_run(const struct Capture *c)
+{
+    uint32_t period = cpu_hz / c->rate;
+    volatile uint8_t *port = c->port;
+    uint8_t *p = capture_buf, *end = capture_buf + c->count;
+    uint16_t t;
+
+    // Timer target has to stay within half of its range
+    if (period < MIN_PERIOD || period > 0x7FFF)
+        return FALSE;
+
+    if (console_out != OUT_RAW) {
+        console_puts("CAPTURE: ");
+        console_putdec(c->count);
+        console_puts(" @ ");
+        console_putdec(cpu_hz / period);
+        console_puts(" Hz");
+        console_newline();
+    }
+
+#if CONFIG_EDGES
+    // Buffer is shared
+    edges_stop();
+    edge_tail = edge_head;
+#endif
+
+    // Soft UART transmit doesn't survive interrupts being disabled
+    uart_flush();
+    if (c->trig_port && !wait_trigger(c)) {
+        console_puts("ABORTED");
+        console_newline();
+        return TRUE;
+    }
+
+    dint();
+    t = cpu_ticks();
+    while (p < end) {
+        // Count timer overflows here, TIMERA1 ISR can't while interrupts
+        // are off and a long capture would miss more than one
+        while ((int16_t)(cpu_ticks() - t) < 0) {
+            if (TACTL & TAIFG) {
+                TACTL &= ~TAIFG;
+                cpu_ticks_hi++;
+            }
+        }
+        *p++ = *port;
+        t += period;
+    }
+    eint();
+
+    upload(c);
+    return TRUE;
+}
+
+#endif
@@ -0,0 +1,39 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef CAPTURE_H
+#define CAPTURE_H 1
+
+#include "common.h"
+
+struct Capture {
+    volatile uint8_t *port;         // PxIN to sample
+    uint8_t mask;                   // pins to keep, others read as 0
+    uint32_t rate;                  // samples per second
+    uint16_t count;                 // number of samples
+    volatile uint8_t *trig_port;    // PxIN of trigger pin, NULL if none
+    uint8_t trig_mask;
+    BOOL trig_rise;                 // rising or falling edge
+};
+
+BOOL capture_run(const struct Capture *c);
+
+void edges_start(volatile uint8_t *port, uint8_t mask);
+void edges_stop(void);
+void edges_drop(volatile uint8_t *port, uint8_t mask);
+void edges_dump(void);
+void edges_irq(volatile uint8_t *port);
+
+#endif
@@ -23,6 +23,8 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "config.h"
+
 #ifndef TRUE
 #define TRUE true
 #endif
@@ -33,9 +35,20 @@
 typedef bool BOOL;
 #endif
 
-void driver_tick(void);
-
-enum {BUS_HIZ, BUS_SPI};
+enum {
+    BUS_HIZ,
+    BUS_SPI,
+#if CONFIG_BBSPI
+    BUS_BBSPI,
+#endif
+#if CONFIG_I2C
+    BUS_I2C,
+#endif
+#if CONFIG_SNIFF
+    BUS_SNIFF,
+#endif
+    BUS_COUNT
+};
 
 #endif
 
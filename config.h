@@ -0,0 +1,180 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef CONFIG_H
+#define CONFIG_H 1
+
+/*
+ * Compile-time feature selection. 2K parts (G2231 of the original
+ * Launchpad) only have room for the basic shell, so optional features
+ * are on by default only when FULL_FEATURES is set (the Makefile does
+ * that for bigger MCUs). Any of them can be overridden with
+ * make CONFIG="-DCONFIG_xxx=0|1".
+ */
+#ifndef FULL_FEATURES
+#define FULL_FEATURES 0
+#endif
+
+// Bus Pirate compatible binary mode (raw SPI), for flashrom & co.
+#ifndef CONFIG_BINMODE
+#define CONFIG_BINMODE FULL_FEATURES
+#endif
+
+// Terse/raw output formats for bus data ("out" command)
+#ifndef CONFIG_OUTFMT
+#define CONFIG_OUTFMT FULL_FEATURES
+#endif
+
+// "baud" command to change UART speed at runtime
+#ifndef CONFIG_BAUD
+#define CONFIG_BAUD FULL_FEATURES
+#endif
+
+// "spi speed|mode|lsb|msb" runtime SPI configuration
+#ifndef CONFIG_SPI_CONFIG
+#define CONFIG_SPI_CONFIG FULL_FEATURES
+#endif
+
+// w"<hex>" bulk write command
+#ifndef CONFIG_PAYLOAD
+#define CONFIG_PAYLOAD FULL_FEATURES
+#endif
+
+// "flash" commands for 25-series SPI NOR flashes
+#ifndef CONFIG_FLASH
+#define CONFIG_FLASH FULL_FEATURES
+#endif
+
+// ?mask=value:timeout bus command
+#ifndef CONFIG_POLL
+#define CONFIG_POLL FULL_FEATURES
+#endif
+
+// r:<n>c / r:<n>C - CRC over repeated reads
+#ifndef CONFIG_CRC
+#define CONFIG_CRC FULL_FEATURES
+#endif
+
+// CRC used for data checks, 32 or 16 (smaller/faster on small parts)
+#ifndef CRC_BITS
+#if FULL_FEATURES
+#define CRC_BITS 32
+#else
+#define CRC_BITS 16
+#endif
+#endif
+
+// v"<hex>" command to verify read data against expected bytes
+#ifndef CONFIG_VERIFY
+#define CONFIG_VERIFY FULL_FEATURES
+#endif
+
+// Command line macros in info flash ("macro" command, @n)
+#ifndef CONFIG_MACRO
+#define CONFIG_MACRO FULL_FEATURES
+#endif
+
+// Compile bus command lines before running them (takes ~80 bytes RAM)
+#ifndef CONFIG_COMPILE
+#define CONFIG_COMPILE FULL_FEATURES
+#endif
+
+// Bitbang SPI bus on any P1/P2 pins ("bbspi" command)
+#ifndef CONFIG_BBSPI
+#define CONFIG_BBSPI FULL_FEATURES
+#endif
+
+// USI I2C master bus ("i2c" command)
+#ifndef CONFIG_I2C
+#ifdef __MSP430_HAS_USI__
+#define CONFIG_I2C FULL_FEATURES
+#else
+#define CONFIG_I2C 0
+#endif
+#endif
+
+// "capture" command - sample port pins into RAM (logic analyser)
+#ifndef CONFIG_CAPTURE
+#define CONFIG_CAPTURE FULL_FEATURES
+#endif
+
+// "edges" and "dump" commands - record timestamped pin changes
+#ifndef CONFIG_EDGES
+#define CONFIG_EDGES FULL_FEATURES
+#endif
+
+// Passive SPI sniffer bus on USI ("sniff" command)
+#ifndef CONFIG_SNIFF
+#ifdef __MSP430_HAS_USI__
+#define CONFIG_SNIFF FULL_FEATURES
+#else
+#define CONFIG_SNIFF 0
+#endif
+#endif
+
+// "stats" command
+#ifndef CONFIG_STATS
+#define CONFIG_STATS FULL_FEATURES
+#endif
+
+// UART receive FIFO size, power of 2 up to 128
+#ifndef UART_RX_BUF_SIZ
+#if FULL_FEATURES
+#define UART_RX_BUF_SIZ 64
+#else
+#define UART_RX_BUF_SIZ 8
+#endif
+#endif
+
+// UART transmit FIFO size, power of 2 up to 128
+#ifndef UART_TX_BUF_SIZ
+#if FULL_FEATURES
+#define UART_TX_BUF_SIZ 64
+#else
+#define UART_TX_BUF_SIZ 8
+#endif
+#endif
+
+// Capture buffer size in bytes: 1 per sample, 4 per edge; power of 2
+#ifndef CAPTURE_BUF_SIZ
+#define CAPTURE_BUF_SIZ 128
+#endif
+
+// Sniffer ring buffer, in entries (2 bytes each), power of 2 up to 128
+#ifndef SNIFF_BUF_SIZ
+#define SNIFF_BUF_SIZ 64
+#endif
+
+#if CONFIG_FLASH && !CONFIG_OUTFMT
+#error CONFIG_FLASH requires CONFIG_OUTFMT
+#endif
+
+#if CONFIG_I2C && !defined(__MSP430_HAS_USI__)
+#error CONFIG_I2C requires USI
+#endif
+
+#if CONFIG_SNIFF && !defined(__MSP430_HAS_USI__)
+#error CONFIG_SNIFF requires USI
+#endif
+
+#if CONFIG_SNIFF && !CONFIG_OUTFMT
+#error CONFIG_SNIFF requires CONFIG_OUTFMT
+#endif
+
+#if CONFIG_VERIFY && !CONFIG_PAYLOAD
+#error CONFIG_VERIFY requires CONFIG_PAYLOAD
+#endif
+
+#endif
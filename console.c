@@ -17,6 +17,9 @@
 #include "console.h"
 #include "shell.h"
 #include "uart.h"
+#include "binmode.h"
+#include "cpu.h"
+#include "stats.h"
 
 #define CMDBUF_SIZ 64
 
@@ -24,15 +27,21 @@
 #error Commands over 255 bytes not supported, change type of cmdbuf_len
 #endif
 
-#define ABS(x) ( (x) < 0 ? (-(x)) : (x) )
-
 /**************************************************************/
 
 static uint8_t cmdbuf_len; // number of bytes in command buf
 static uint8_t cmdbuf[CMDBUF_SIZ];
 static BOOL got_line = FALSE;
+#if CONFIG_BINMODE
+static uint8_t nul_count;
+#endif
 BOOL console_echo = 1;
 char *console_prompt = "";
+#if CONFIG_OUTFMT
+uint8_t console_out = OUT_VERBOSE;
+BOOL console_quiet;
+static uint8_t out_col; // items on current line in terse formats
+#endif
 
 /**************************************************************/
 
@@ -51,6 +60,20 @@ void console_init(void)
 
 static void console_rx(uint8_t c)
 {
+#if CONFIG_BINMODE
+    // Bus Pirate way to enter binary mode
+    if (c == 0) {
+        if (++nul_count == BINMODE_NULS) {
+            nul_count = 0;
+            cmdbuf_len = 0;
+            shell_binmode();
+            prompt();
+        }
+        return;
+    }
+    nul_count = 0;
+#endif
+
     if (got_line)   // throw away chars until the line is handled
         return;
 
@@ -87,17 +110,28 @@ static void console_rx(uint8_t c)
 
 void console_tick(void)
 {
-    if (!got_line)
+    uint8_t c;
+#if CONFIG_STATS
+    uint32_t t;
+#endif
+
+    // Lines sent ahead of time wait in UART FIFO, handle all of them,
+    // as there will be no more RX events for them
+    while (1)
     {
-        uint8_t c;
-        if (uart_getc(&c))
+        while (!got_line && uart_getc(&c))
             console_rx(c);
-    }
+        if (!got_line)
+            break;
 
-    if (got_line)
-    {
+#if CONFIG_STATS
+        t = cpu_ticks32();
+#endif
         if (cmdbuf_len > 0)
             shell_eval(cmdbuf, cmdbuf_len);
+#if CONFIG_STATS
+        stats_command(cpu_ticks32() - t);
+#endif
         cmdbuf_len = 0;
         prompt();
         got_line = FALSE;
@@ -169,13 +203,19 @@ void console_putsmem(const uint8_t *a, const uint8_t *b)
 
 void console_putdec(int32_t n)
 {
-    int32_t m;
-    BOOL in_leading_zeroes = TRUE;
-
-    if (n < 0)
+    if (n < 0) {
         console_putc('-');
+        console_putudec(-(uint32_t)n);
+    } else {
+        console_putudec(n);
+    }
+}
 
-    n = ABS(n);
+// For counters and cycle totals, which may go past 2^31
+void console_putudec(uint32_t n)
+{
+    uint32_t m;
+    BOOL in_leading_zeroes = TRUE;
 
     for (m = 1000000000; m != 1; m/=10)
     {
@@ -201,3 +241,41 @@ void console_putbin(uint8_t b)
     (b & 0x01) ? console_putc('1') : console_putc('0');
 }
 
+
+#if CONFIG_OUTFMT
+/*
+ * Terse output formats: "hex" - items separated with spaces, "packed" -
+ * no separators, both 16 items per line; "raw" - just binary bytes.
+ */
+void console_putmark(uint8_t mark)
+{
+    if (out_col == 16) {
+        console_newline();
+        out_col = 0;
+    }
+    if (out_col && console_out == OUT_HEX)
+        console_putc(' ');
+    out_col++;
+    if (mark)
+        console_putc(mark);
+}
+
+void console_putdata(uint8_t c)
+{
+    if (console_out == OUT_RAW) {
+        console_putc(c);
+        return;
+    }
+    console_putmark(0);
+    console_puthex8(c);
+}
+
+// Terminate pending line of terse output
+void console_endline(void)
+{
+    if (out_col) {
+        console_newline();
+        out_col = 0;
+    }
+}
+#endif
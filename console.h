@@ -30,11 +30,31 @@ void console_puthex16(uint16_t h);
 void console_puthex32(uint32_t h);
 void console_put0x8(uint8_t h);
 void console_putdec(int32_t i);
+void console_putudec(uint32_t i);
 void console_putbin(uint8_t b);
 void console_putsmem(const uint8_t *a, const uint8_t *b);
 
 extern BOOL console_echo;
 extern char *console_prompt;
 
+// Output formats for bus data
+enum {OUT_VERBOSE, OUT_HEX, OUT_PACKED, OUT_RAW};
+
+#if CONFIG_OUTFMT
+void console_putdata(uint8_t c);
+void console_putmark(uint8_t mark);
+void console_endline(void);
+
+extern uint8_t console_out;
+extern BOOL console_quiet;
+#else
+static inline void console_putdata(uint8_t c) {}
+static inline void console_putmark(uint8_t mark) {}
+static inline void console_endline(void) {}
+
+#define console_out OUT_VERBOSE
+#define console_quiet FALSE
+#endif
+
 #endif
 
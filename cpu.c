@@ -15,11 +15,102 @@
 */
 #include "cpu.h"
 
+#if CPU_MHZ == 16
+#define CALBC1 CALBC1_16MHZ
+#define CALDCO CALDCO_16MHZ
+#elif CPU_MHZ == 12
+#define CALBC1 CALBC1_12MHZ
+#define CALDCO CALDCO_12MHZ
+#elif CPU_MHZ == 8
+#define CALBC1 CALBC1_8MHZ
+#define CALDCO CALDCO_8MHZ
+#elif CPU_MHZ != 1
+#error CPU_MHZ must be 1, 8, 12 or 16
+#endif
+
+uint32_t cpu_hz;
+volatile uint16_t cpu_ticks_hi;
+static uint8_t cycles_per_us;
+static uint16_t cycles_per_ms;
+
 void cpu_init(void)
 {
     WDTCTL = WDTPW + WDTHOLD; // Stop WDT
-      
-    BCSCTL1 = CALBC1_1MHZ; // Set range
-    DCOCTL = CALDCO_1MHZ; // SMCLK = DCO = 1MHz
+
+    DCOCTL = 0; // Lowest DCO setting while switching range
+#if CPU_MHZ != 1
+    // Not all parts have all calibration constants (e.g. G2231 has
+    // only 1MHz one), fall back to 1MHz if it's erased.
+    if (CALBC1 != 0xFF) {
+        BCSCTL1 = CALBC1; // Set range
+        DCOCTL = CALDCO; // SMCLK = DCO = CPU_MHZ
+        cpu_hz = CPU_MHZ * 1000000UL;
+    } else
+#endif
+    {
+        BCSCTL1 = CALBC1_1MHZ; // Set range
+        DCOCTL = CALDCO_1MHZ; // SMCLK = DCO = 1MHz
+        cpu_hz = 1000000;
+    }
+
+    cycles_per_us = cpu_hz / 1000000;
+    cycles_per_ms = cpu_hz / 1000;
+
+    // SMCLK, continuous mode, for cpu_ticks(); overflow for cpu_ticks32()
+    TACTL = TASSEL_2 + MC_2 + TAIE;
+}
+
+uint32_t cpu_ticks32(void)
+{
+    uint16_t hi, lo;
+
+    // Retry if overflow was counted meanwhile
+    do {
+        hi = cpu_ticks_hi;
+        lo = TAR;
+    } while (hi != cpu_ticks_hi);
+    return (uint32_t)hi << 16 | lo;
+}
+
+// Wait until given number of cycles passes since timestamp t
+static void delay_since(uint16_t t, uint32_t cycles)
+{
+    uint16_t step;
+
+    // Timer target has to stay within half of its range
+    while (cycles) {
+        step = cycles > 0x4000 ? 0x4000 : cycles;
+        t += step;
+        cycles -= step;
+        while ((int16_t)(cpu_ticks() - t) < 0);
+    }
+}
+
+void cpu_delay_cycles(uint32_t cycles)
+{
+    delay_since(cpu_ticks(), cycles);
+}
+
+// Time of multiplication (no hardware multiplier on small parts) is
+// included in the delay, so only very short ones come out longer
+void cpu_delay_us(uint16_t us)
+{
+    uint16_t t = cpu_ticks();
+    delay_since(t, (uint32_t)us * cycles_per_us);
+}
+
+void cpu_delay_ms(uint16_t ms)
+{
+    uint16_t t = cpu_ticks();
+    delay_since(t, (uint32_t)ms * cycles_per_ms);
+}
+
+#ifdef UART_USCI
+// Soft UART owns this vector otherwise and counts overflows there
+interrupt(TIMERA1_VECTOR) TIMERA1_ISR(void)
+{
+    if (TAIV == 10) // TAIFG
+        cpu_ticks_hi++;
 }
+#endif
 
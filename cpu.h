@@ -18,7 +18,29 @@
 
 #include "common.h"
 
+// MCLK = SMCLK frequency to run at, 1, 8, 12 or 16
+#ifndef CPU_MHZ
+#define CPU_MHZ 1
+#endif
+
+// Actual MCLK = SMCLK frequency, all timings are derived from it
+extern uint32_t cpu_hz;
+
 void cpu_init(void);
 
+// Free-running SMCLK cycle counter (Timer_A in continuous mode), wraps
+// at 16 bits, so use differences only
+#define cpu_ticks() TAR
+
+// Same, extended to 32 bits with Timer_A overflow interrupt, for longer
+// intervals. Needs interrupts enabled.
+extern volatile uint16_t cpu_ticks_hi;
+uint32_t cpu_ticks32(void);
+
+// Busy wait, at least the given time
+void cpu_delay_cycles(uint32_t cycles);
+void cpu_delay_us(uint16_t us);
+void cpu_delay_ms(uint16_t ms);
+
 #endif
 
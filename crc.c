@@ -0,0 +1,72 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * Nibble table CRCs: 16-entry tables are a good compromise between speed
+ * and flash use on MSP430 (byte table would take 1K for CRC32).
+ */
+#include "common.h"
+#include "console.h"
+#include "crc.h"
+
+#if CRC_BITS == 32
+
+static const uint32_t crc_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+crc_t crc_update(crc_t crc, uint8_t c)
+{
+    // Reflected, low nibble first
+    crc = crc_table[(crc ^ c) & 0x0F] ^ (crc >> 4);
+    crc = crc_table[(crc ^ (c >> 4)) & 0x0F] ^ (crc >> 4);
+    return crc;
+}
+
+// Print final CRC value
+void crc_report(crc_t crc)
+{
+    console_puts("CRC32: 0x");
+    console_puthex32(~crc);
+    console_newline();
+}
+
+#else
+
+static const uint16_t crc_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+crc_t crc_update(crc_t crc, uint8_t c)
+{
+    // High nibble first
+    crc = (crc << 4) ^ crc_table[(crc >> 12) ^ (c >> 4)];
+    crc = (crc << 4) ^ crc_table[(crc >> 12) ^ (c & 0x0F)];
+    return crc;
+}
+
+// Print final CRC value
+void crc_report(crc_t crc)
+{
+    console_puts("CRC16: 0x");
+    console_puthex16(crc);
+    console_newline();
+}
+
+#endif
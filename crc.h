@@ -0,0 +1,34 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef CRC_H
+#define CRC_H 1
+
+#include "common.h"
+
+#if CRC_BITS == 32
+// CRC-32 (IEEE 802.3, same as zlib crc32())
+typedef uint32_t crc_t;
+#define CRC_INIT 0xFFFFFFFF
+#else
+// CRC-16/CCITT-FALSE
+typedef uint16_t crc_t;
+#define CRC_INIT 0xFFFF
+#endif
+
+crc_t crc_update(crc_t crc, uint8_t c);
+void crc_report(crc_t crc);
+
+#endif
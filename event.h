@@ -0,0 +1,38 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef EVENT_H
+#define EVENT_H 1
+
+#include "common.h"
+
+/*
+ * Main loop only runs when ISRs have posted an event, and sleeps in LPM0
+ * otherwise. LPM3 is not an option: soft UART and USCI UART both run
+ * from SMCLK (there's no 32kHz crystal on Launchpad for ACLK baud rates,
+ * and VLO is too inaccurate), so SMCLK has to stay on to receive.
+ */
+#define EV_UART_RX      0x01    // byte(s) in UART receive FIFO
+#define EV_BUS          0x02    // current bus has data, see Bus.tick
+
+extern volatile uint8_t events;
+
+// Post event from ISR, CPU stays awake after return to handle it
+#define event_post_isr(ev) do { events |= (ev); LPM0_EXIT; } while (0)
+
+void event_run(uint8_t mask);
+void event_loop(void);
+
+#endif
@@ -0,0 +1,35 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef FIFO_H
+#define FIFO_H 1
+
+#include "common.h"
+
+/*
+ * Single producer/single consumer byte FIFO, safe to use between an ISR
+ * and the main loop. Size must be a power of 2, up to 128. Indexes are
+ * free-running, so head - tail is number of bytes queued.
+ */
+#define FIFO(name, size) \
+    struct { volatile uint8_t head, tail; uint8_t buf[size]; } name
+
+#define FIFO_LEN(f)     ((uint8_t)((f).head - (f).tail))
+#define FIFO_EMPTY(f)   ((f).head == (f).tail)
+#define FIFO_FULL(f)    (FIFO_LEN(f) == sizeof((f).buf))
+#define FIFO_PUT(f, c)  ((f).buf[(f).head & (sizeof((f).buf) - 1)] = (c), (f).head++)
+#define FIFO_GET(f)     ((f).buf[(f).tail++ & (sizeof((f).buf) - 1)])
+
+#endif
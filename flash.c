@@ -0,0 +1,214 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * On-device engine for 25-series SPI NOR flashes, talking to spi_bus
+ * directly, so bulk operations run at SPI and UART speed rather than at
+ * command parsing speed.
+ */
+#include "common.h"
+#include "console.h"
+#include "flash.h"
+#include "spi.h"
+#include "cpu.h"
+#include "bus.h"
+#include "crc.h"
+
+#if CONFIG_FLASH
+
+// Time chip was busy during current erase/write, in SMCLK cycles
+static uint32_t busy_ticks;
+
+// flash_write_*() state
+static uint32_t write_addr;
+static BOOL page_open;
+static BOOL write_ok;
+
+// Assert CS and send command with 3 or 4 byte address
+static void flash_cmd_addr(uint8_t cmd, uint32_t addr, BOOL addr4)
+{
+    spi_bus.start();
+    spi_bus.xact(cmd);
+    if (addr4)
+        spi_bus.xact(addr >> 24);
+    spi_bus.xact(addr >> 16);
+    spi_bus.xact(addr >> 8);
+    spi_bus.xact(addr);
+}
+
+/*
+ * Read len bytes starting at addr with a single READ (or FAST_READ)
+ * command, output them in current compact format ("packed" if it's
+ * verbose), unless crc_only, followed by CRC of all bytes. 4-byte
+ * address commands are used if the range goes beyond 16MB.
+ */
+void flash_read(uint32_t addr, uint32_t len, BOOL fast, BOOL crc_only)
+{
+    BOOL addr4 = addr + len > 0x1000000;
+    crc_t crc = CRC_INIT;
+    uint8_t c;
+
+    if (fast) {
+        flash_cmd_addr(addr4 ? FLASH_FAST_READ4 : FLASH_FAST_READ, addr, addr4);
+        spi_bus.xact(0xFF); // dummy byte
+    } else {
+        flash_cmd_addr(addr4 ? FLASH_READ4 : FLASH_READ, addr, addr4);
+    }
+
+    while (len--) {
+        c = spi_bus.xact(0xFF);
+        crc = crc_update(crc, c);
+        if (!crc_only)
+            console_putdata(c);
+    }
+    spi_bus.stop();
+
+    console_endline();
+    crc_report(crc);
+}
+
+// Poll status until WIP clears or timeout expires
+static BOOL flash_wait(uint16_t timeout_ms)
+{
+    struct BusPoll res;
+    BOOL ok;
+
+    spi_bus.start();
+    spi_bus.xact(FLASH_RDSR);
+    // Status is output continuously while CS is asserted
+    ok = bus_poll(&spi_bus, FLASH_SR_WIP, 0, timeout_ms, &res);
+    spi_bus.stop();
+
+    busy_ticks += res.ticks;
+    return ok;
+}
+
+// Write enable, FALSE if chip didn't accept it (e.g. write protected)
+static BOOL flash_wren(void)
+{
+    uint8_t sr;
+
+    spi_bus.start();
+    spi_bus.xact(FLASH_WREN);
+    spi_bus.stop();
+
+    spi_bus.start();
+    spi_bus.xact(FLASH_RDSR);
+    sr = spi_bus.xact(0xFF);
+    spi_bus.stop();
+    return (sr & (FLASH_SR_WEL | FLASH_SR_WIP)) == FLASH_SR_WEL;
+}
+
+static void flash_report(BOOL ok)
+{
+    console_puts(ok ? "OK " : "FAIL ");
+    console_putdec(busy_ticks / (cpu_hz / 1000));
+    console_puts(" ms");
+    console_newline();
+}
+
+/*
+ * Erase all 4K sectors covering addr..addr+len, using 64K block erase
+ * where possible.
+ */
+void flash_erase(uint32_t addr, uint32_t len)
+{
+    uint32_t end = addr + len;
+    uint32_t step;
+    // Same as end > 16M, without overflow in addr + len
+    BOOL addr4 = addr >= 0x1000000 || len > 0x1000000 - addr;
+    BOOL ok = TRUE;
+    uint8_t cmd;
+
+    // Sector around addr would be erased otherwise
+    if (!len)
+        return;
+    busy_ticks = 0;
+    addr &= ~0xFFFUL;
+    while (ok && addr < end) {
+        if (!(addr & 0xFFFF) && end - addr >= 0x10000) {
+            cmd = addr4 ? FLASH_BE4 : FLASH_BE;
+            step = 0x10000;
+        } else {
+            cmd = addr4 ? FLASH_SE4 : FLASH_SE;
+            step = 0x1000;
+        }
+        ok = flash_wren();
+        if (ok) {
+            flash_cmd_addr(cmd, addr, addr4);
+            spi_bus.stop();
+            ok = flash_wait(FLASH_ERASE_TIMEOUT_MS);
+        }
+        addr += step;
+    }
+    flash_report(ok);
+}
+
+/*
+ * Streamed programming: bytes fed one by one with flash_write_byte()
+ * are sent with PAGE PROGRAM commands, split at page boundaries. CS
+ * stays asserted while waiting for more data (e.g. next input line).
+ */
+void flash_write_begin(uint32_t addr)
+{
+    write_addr = addr;
+    page_open = FALSE;
+    write_ok = TRUE;
+    busy_ticks = 0;
+}
+
+static void flash_write_close(void)
+{
+    spi_bus.stop();
+    page_open = FALSE;
+    write_ok = flash_wait(FLASH_PP_TIMEOUT_MS);
+}
+
+BOOL flash_write_byte(uint8_t c)
+{
+    if (!write_ok)
+        return FALSE;
+
+    if (!page_open) {
+        BOOL addr4 = write_addr >= 0x1000000;
+        if (!(write_ok = flash_wren()))
+            return FALSE;
+        flash_cmd_addr(addr4 ? FLASH_PP4 : FLASH_PP, write_addr, addr4);
+        page_open = TRUE;
+    }
+
+    spi_bus.xact(c);
+    write_addr++;
+    if (!(write_addr & (FLASH_PAGE_SIZE - 1)))
+        flash_write_close();
+    return write_ok;
+}
+
+void flash_write_end(void)
+{
+    if (page_open)
+        flash_write_close();
+    flash_report(write_ok);
+}
+
+// Data ended early, bytes queued so far are still programmed
+void flash_write_abort(void)
+{
+    if (page_open)
+        flash_write_close();
+    flash_report(FALSE);
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef FLASH_H
+#define FLASH_H 1
+
+#include "common.h"
+
+// 25-series SPI NOR flash commands
+#define FLASH_READ          0x03
+#define FLASH_FAST_READ     0x0B
+#define FLASH_READ4         0x13 // 4-byte address versions
+#define FLASH_FAST_READ4    0x0C
+#define FLASH_WREN          0x06
+#define FLASH_RDSR          0x05
+#define FLASH_PP            0x02
+#define FLASH_PP4           0x12
+#define FLASH_SE            0x20 // 4K sector erase
+#define FLASH_SE4           0x21
+#define FLASH_BE            0xD8 // 64K block erase
+#define FLASH_BE4           0xDC
+
+// Status register bits
+#define FLASH_SR_WIP        0x01
+#define FLASH_SR_WEL        0x02
+
+#define FLASH_PAGE_SIZE     256
+
+// Max time to wait for an operation to complete
+#define FLASH_PP_TIMEOUT_MS     50
+#define FLASH_ERASE_TIMEOUT_MS  5000
+
+void flash_read(uint32_t addr, uint32_t len, BOOL fast, BOOL crc_only);
+void flash_erase(uint32_t addr, uint32_t len);
+
+void flash_write_begin(uint32_t addr);
+BOOL flash_write_byte(uint8_t c);
+void flash_write_end(void);
+void flash_write_abort(void);
+
+#endif
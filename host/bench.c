@@ -0,0 +1,314 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * Host microbenchmarks for the shell hot paths. Numbers are for the
+ * host CPU, so only compare them with runs on the same machine. Output
+ * of the benchmarked paths is checked against the mock bus first, and
+ * the exit status is non-zero if it's wrong.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "common.h"
+#include "console.h"
+#include "crc.h"
+#include "parse.h"
+#include "shell.h"
+#include "spi.h"
+#include "bbspi.h"
+#include "host.h"
+
+// Minimum time to run each benchmark for
+#define BENCH_NS 200000000LL
+
+static const char *shell_lines[] = {
+    "[0x40 0x0A 0x28]",
+    "[0x40 0x09 0xff]",
+    "[0x03 0 0 0 r:16]",
+    "{0x9f 0 0 0}",
+    "[0x06] [0x02 0 0x10 0 w\"0123456789abcdef0123456789abcdef\"]",
+    "[0x05 r:64C]",
+};
+
+static const char *out_formats[] = {
+    "out verbose", "out hex", "out packed", "out raw", "out hex quiet",
+};
+
+static const char *numbers[] = {
+    "7", "255", "0xff", "0x1234", "65535", "0b10100101",
+};
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void eval(const char *s)
+{
+    shell_eval((const uint8_t *)s, strlen(s));
+}
+
+static int failures;
+
+static void check(BOOL ok, const char *what, const char *line)
+{
+    if (!ok) {
+        printf("FAIL: %s: %s\n", line, what);
+        failures++;
+    }
+}
+
+static void log_reset(void)
+{
+    host_uart_log_len = host_spi_log_len = 0;
+}
+
+// Reads split in result chunks must reach UART whole and in order
+static void check_reads(void)
+{
+    static const struct {
+        const char *line;
+        uint16_t bytes; // on the bus, and in raw output
+    } reads[] = {
+        {"[r:40]", 40},
+        {"[r.16:21]", 42},
+        {"[r.12:9]", 18},
+        // Byte read while writing is output too
+        {"{0x9f r.16:17}", 35},
+    };
+    unsigned i;
+
+    eval("spi");
+    eval("out raw quiet");
+    for (i = 0; i < sizeof(reads) / sizeof(*reads); i++) {
+        log_reset();
+        eval(reads[i].line);
+        check(host_spi_log_len == reads[i].bytes, "bus bytes", reads[i].line);
+        check(host_uart_log_len == reads[i].bytes, "UART bytes",
+              reads[i].line);
+        check(!memcmp(host_uart_log, host_spi_miso, host_spi_log_len),
+              "data", reads[i].line);
+    }
+    eval("out verbose");
+    eval("hiz");
+}
+
+static uint32_t ref_crc(const uint8_t *p, unsigned len)
+{
+#if CRC_BITS == 32
+    uint32_t crc = 0xFFFFFFFF;
+    unsigned i;
+
+    while (len--) {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+            crc = crc >> 1 ^ (crc & 1 ? 0xEDB88320 : 0);
+    }
+    return ~crc;
+#else
+    uint16_t crc = 0xFFFF;
+    unsigned i;
+
+    while (len--) {
+        crc ^= *p++ << 8;
+        for (i = 0; i < 8; i++)
+            crc = crc << 1 ^ (crc & 0x8000 ? 0x1021 : 0);
+    }
+    return crc;
+#endif
+}
+
+// w"..." payload, also continued on next line: bytes on the bus, and
+// count and CRC in the summary
+static void check_write(const char *first, const char *rest)
+{
+    uint8_t data[HOST_LOG_SIZ];
+    char text[HOST_LOG_SIZ + 1], expect[40];
+    unsigned len;
+
+    eval("spi");
+    log_reset();
+    eval(first);
+    if (rest)
+        eval(rest);
+    len = host_spi_log_len - 1; // command byte first
+    memcpy(data, host_spi_mosi + 1, len);
+    memcpy(text, host_uart_log, host_uart_log_len);
+    text[host_uart_log_len] = '\0';
+
+    check(len == 40, "byte count", first);
+    check(!memcmp(data, "\x01\x23\x45\x67\x89\xab\xcd\xef", 8),
+          "data", first);
+    snprintf(expect, sizeof(expect), "WROTE: %u", len);
+    check(strstr(text, expect) != NULL, "WROTE", first);
+#if CRC_BITS == 32
+    snprintf(expect, sizeof(expect), "CRC32: 0x%08lX",
+             (unsigned long)ref_crc(data, len));
+#else
+    snprintf(expect, sizeof(expect), "CRC16: 0x%04X",
+             (unsigned)ref_crc(data, len));
+#endif
+    check(strstr(text, expect) != NULL, "CRC", first);
+    eval("hiz");
+}
+
+static void bench_shell(void)
+{
+    unsigned f, i;
+    uint32_t n, tx, spi;
+    int64_t t;
+
+    printf("%-60s %10s %10s %10s\n", "shell_eval()", "ns/line", "ns/SPI B",
+           "UART/SPI B");
+    eval("spi");
+    for (f = 0; f < sizeof(out_formats) / sizeof(*out_formats); f++) {
+        eval(out_formats[f]);
+        printf("%s\n", out_formats[f]);
+        for (i = 0; i < sizeof(shell_lines) / sizeof(*shell_lines); i++) {
+            host_uart_tx = host_spi_xact = 0;
+            t = now_ns();
+            n = 0;
+            do {
+                eval(shell_lines[i]);
+                console_endline();
+                n++;
+            } while (now_ns() - t < BENCH_NS);
+            t = now_ns() - t;
+            tx = host_uart_tx;
+            spi = host_spi_xact;
+            printf("  %-58s %10.1f %10.1f %10.2f\n", shell_lines[i],
+                   (double)t / n, (double)t / spi, (double)tx / spi);
+        }
+    }
+    eval("out verbose");
+}
+
+static void bench_bus(const char *name, const char *select, struct Bus *bus)
+{
+    uint32_t n;
+    uint8_t sum = 0;
+    int64_t t;
+
+    eval(select);
+    t = now_ns();
+    n = 0;
+    do {
+        sum += bus->xact(n);
+        n++;
+    } while ((n & 0xFFF) || now_ns() - t < BENCH_NS);
+    t = now_ns() - t;
+    printf("  %-58s %10.1f\n", name, (double)t / n);
+    eval("hiz");
+    if (sum == 1)
+        printf("\n");
+}
+
+static void bench_buses(void)
+{
+    printf("\n%-60s %10s\n", "Bus xact()", "ns/byte");
+    bench_bus("spi (mock)", "spi", &spi_bus);
+    bench_bus("bbspi mode 0", "bbspi mode 0", &bbspi_bus);
+    bench_bus("bbspi mode 1", "bbspi mode 1", &bbspi_bus);
+}
+
+static void bench_parse(void)
+{
+    unsigned i;
+    uint32_t n;
+    uint16_t v, sum = 0;
+    int64_t t;
+
+    printf("\n%-60s %10s\n", "parse_number_str()", "ns/call");
+    for (i = 0; i < sizeof(numbers) / sizeof(*numbers); i++) {
+        t = now_ns();
+        n = 0;
+        do {
+            parse_number_str((const uint8_t *)numbers[i], &v);
+            sum += v;
+            n++;
+        } while ((n & 0xFFF) || now_ns() - t < BENCH_NS);
+        t = now_ns() - t;
+        printf("  %-58s %10.1f\n", numbers[i], (double)t / n);
+    }
+    if (sum == 1)
+        printf("\n");
+}
+
+static void bench_console(void)
+{
+    static const int32_t values[] = {0, 9, 255, 65535, 2147483647, -1};
+    unsigned i;
+    uint32_t n;
+    int64_t t;
+    char name[32];
+
+    printf("\n%-60s %10s %10s\n", "console output", "ns/call", "bytes");
+    for (i = 0; i < sizeof(values) / sizeof(*values); i++) {
+        host_uart_tx = 0;
+        t = now_ns();
+        n = 0;
+        do {
+            console_putdec(values[i]);
+            n++;
+        } while ((n & 0xFFF) || now_ns() - t < BENCH_NS);
+        t = now_ns() - t;
+        snprintf(name, sizeof(name), "console_putdec(%ld)", (long)values[i]);
+        printf("  %-58s %10.1f %10.1f\n", name, (double)t / n,
+               (double)host_uart_tx / n);
+    }
+
+    host_uart_tx = 0;
+    t = now_ns();
+    n = 0;
+    do {
+        console_putbin(n);
+        n++;
+    } while ((n & 0xFFF) || now_ns() - t < BENCH_NS);
+    t = now_ns() - t;
+    printf("  %-58s %10.1f %10.1f\n", "console_putbin()", (double)t / n,
+           (double)host_uart_tx / n);
+
+    host_uart_tx = 0;
+    t = now_ns();
+    n = 0;
+    do {
+        console_puthex8(n);
+        n++;
+    } while ((n & 0xFFF) || now_ns() - t < BENCH_NS);
+    t = now_ns() - t;
+    printf("  %-58s %10.1f %10.1f\n", "console_puthex8()", (double)t / n,
+           (double)host_uart_tx / n);
+}
+
+int main(void)
+{
+    console_init();
+    shell_init();
+    check_reads();
+    check_write("[0x02 w\"0123456789abcdef0123456789abcdef"
+                "0123456789abcdef0123456789abcdef0123456789abcdef\"]", NULL);
+    check_write("[0x02 w\"0123456789abcdef 0123456789abcdef",
+                "0123456789abcdef0123456789abcdef0123456789abcdef\"]");
+    if (failures)
+        return 1;
+    bench_shell();
+    bench_buses();
+    bench_parse();
+    bench_console();
+    return 0;
+}
@@ -0,0 +1,35 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef HOST_H
+#define HOST_H 1
+
+#include "common.h"
+
+// Counters kept by the mock UART and SPI bus
+extern uint32_t host_uart_tx;   // bytes sent to UART
+extern uint32_t host_spi_xact;  // bytes clocked on SPI
+
+// First HOST_LOG_SIZ bytes since the length was last reset, for checks
+#define HOST_LOG_SIZ 256
+extern uint8_t host_uart_log[HOST_LOG_SIZ];
+extern uint16_t host_uart_log_len;
+extern uint8_t host_spi_mosi[HOST_LOG_SIZ]; // bytes written on SPI
+extern uint8_t host_spi_miso[HOST_LOG_SIZ]; // and read back
+extern uint16_t host_spi_log_len;
+
+void host_input(const uint8_t *s, uint16_t len);
+
+#endif
@@ -0,0 +1,71 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * Host build stand-in for mspgcc's <io.h>: peripheral registers used by
+ * the shell modules are plain variables defined in host/mock.c.
+ */
+#ifndef HOST_IO_H
+#define HOST_IO_H 1
+
+#include <stdint.h>
+
+#define BIT0 0x01
+#define BIT1 0x02
+#define BIT2 0x04
+#define BIT3 0x08
+#define BIT4 0x10
+#define BIT5 0x20
+#define BIT6 0x40
+#define BIT7 0x80
+
+// Port registers are consecutive, as on the chip (code indexes from PxIN)
+extern volatile uint8_t host_p1[8], host_p2[8];
+#define P1IN  host_p1[0]
+#define P1OUT host_p1[1]
+#define P1DIR host_p1[2]
+#define P1IFG host_p1[3]
+#define P1IES host_p1[4]
+#define P1IE  host_p1[5]
+#define P1SEL host_p1[6]
+#define P1REN host_p1[7]
+#define P2IN  host_p2[0]
+#define P2OUT host_p2[1]
+#define P2DIR host_p2[2]
+#define P2IFG host_p2[3]
+#define P2IES host_p2[4]
+#define P2IE  host_p2[5]
+#define P2SEL host_p2[6]
+#define P2REN host_p2[7]
+
+// Timer_A counter advances on every read, so timeouts expire
+uint16_t host_tar(void);
+#define TAR host_tar()
+extern volatile uint16_t TACTL;
+#define TAIFG 0x0001
+
+// Flash controller
+extern volatile uint16_t FCTL1, FCTL2, FCTL3;
+#define FWKEY   0xA500
+#define FSSEL_1 0x0040
+#define ERASE   0x0002
+#define WRT     0x0040
+#define LOCK    0x0010
+
+// Information memory for macro.c
+extern uint8_t host_info_mem[];
+#define MACRO_BASE host_info_mem
+
+#endif
@@ -0,0 +1,237 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * Mock register, UART and bus layer for the host build. UART output is
+ * only counted (and checksummed, so it can't be optimized away), the
+ * SPI bus returns a running byte pattern.
+ */
+#include "common.h"
+#include "cpu.h"
+#include "uart.h"
+#include "spi.h"
+#include "i2c.h"
+#include "sniff.h"
+#include "hiz.h"
+#include "stats.h"
+#include "host.h"
+
+volatile uint8_t host_p1[8], host_p2[8];
+volatile uint16_t FCTL1, FCTL2, FCTL3;
+volatile uint16_t TACTL;
+uint8_t host_info_mem[3 * 64];
+
+uint32_t cpu_hz = 1000000;
+volatile uint16_t cpu_ticks_hi;
+
+uint16_t host_tar(void)
+{
+    static uint16_t tar;
+    return tar += 16;
+}
+
+uint32_t cpu_ticks32(void)
+{
+    static uint32_t ticks;
+    return ticks += 16;
+}
+
+void cpu_delay_us(uint16_t us)
+{
+}
+
+void cpu_delay_ms(uint16_t ms)
+{
+}
+
+volatile uint8_t events;
+
+void event_run(uint8_t mask)
+{
+}
+
+/**************************************************************/
+
+uint32_t host_uart_tx;
+uint8_t host_uart_sum;
+uint8_t host_uart_log[HOST_LOG_SIZ];
+uint16_t host_uart_log_len;
+static const uint8_t *rx;
+static uint16_t rx_len;
+
+volatile uint16_t uart_rx_overflows;
+uint32_t uart_tx_stall_cycles;
+
+void uart_init(void)
+{
+}
+
+void uart_flush(void)
+{
+}
+
+BOOL uart_set_baud(uint32_t baud)
+{
+    return TRUE;
+}
+
+BOOL uart_getc(uint8_t *c)
+{
+    if (!rx_len)
+        return FALSE;
+    *c = *rx++;
+    rx_len--;
+    return TRUE;
+}
+
+void uart_putc(uint8_t c)
+{
+#if CONFIG_STATS
+    stats.uart_tx_bytes++;
+#endif
+    host_uart_tx++;
+    host_uart_sum += c;
+    if (host_uart_log_len < HOST_LOG_SIZ)
+        host_uart_log[host_uart_log_len++] = c;
+}
+
+// Queue bytes to be returned by uart_getc()
+void host_input(const uint8_t *s, uint16_t len)
+{
+    rx = s;
+    rx_len = len;
+}
+
+/**************************************************************/
+
+uint32_t host_spi_xact;
+uint8_t host_spi_mosi[HOST_LOG_SIZ];
+uint8_t host_spi_miso[HOST_LOG_SIZ];
+uint16_t host_spi_log_len;
+uint32_t spi_speed;
+uint8_t spi_mode;
+BOOL spi_lsb;
+static uint8_t spi_data;
+
+uint32_t spi_configure(void)
+{
+    return cpu_hz / 2;
+}
+
+static void spi_nop(void)
+{
+}
+
+static void spi_log(uint8_t out, uint8_t in)
+{
+    if (host_spi_log_len < HOST_LOG_SIZ) {
+        host_spi_mosi[host_spi_log_len] = out;
+        host_spi_miso[host_spi_log_len++] = in;
+    }
+}
+
+static uint8_t spi_xact(uint8_t c)
+{
+    uint8_t r = spi_data++ ^ c;
+
+#if CONFIG_STATS
+    stats.bus_bytes[BUS_SPI]++;
+#endif
+    host_spi_xact++;
+    spi_log(c, r);
+    return r;
+}
+
+// Logged big endian, like "raw" output of wide values
+static uint16_t spi_xact_bits(uint16_t c, uint8_t bits)
+{
+    uint16_t r = (spi_data++ ^ c) & (0xFFFF >> (16 - bits));
+
+    host_spi_xact += (bits + 7) / 8;
+    if (bits > 8)
+        spi_log(c >> 8, r >> 8);
+    spi_log(c, r);
+    return r;
+}
+
+struct Bus spi_bus = {
+    .prompt = "SPI",
+    .init = spi_nop,
+    .exit = spi_nop,
+    .start = spi_nop,
+    .stop = spi_nop,
+    .xact = spi_xact,
+    .xact_bits = spi_xact_bits,
+    .widths = 0xFFFF,
+};
+
+uint32_t i2c_speed;
+
+uint32_t i2c_configure(void)
+{
+    return i2c_speed;
+}
+
+// Every byte is ACKed
+static uint8_t i2c_write(uint8_t c)
+{
+#if CONFIG_STATS && CONFIG_I2C
+    stats.bus_bytes[BUS_I2C]++;
+#endif
+    return 0;
+}
+
+static uint8_t i2c_read(void)
+{
+#if CONFIG_STATS && CONFIG_I2C
+    stats.bus_bytes[BUS_I2C]++;
+#endif
+    return spi_data++;
+}
+
+struct Bus i2c_bus = {
+    .prompt = "I2C",
+    .init = spi_nop,
+    .exit = spi_nop,
+    .start = spi_nop,
+    .stop = spi_nop,
+    .xact = i2c_write,
+    .read = i2c_read,
+};
+
+static uint8_t hiz_xact(uint8_t c)
+{
+    return 0;
+}
+
+struct Bus hiz_bus = {
+    .prompt = "HiZ",
+    .init = spi_nop,
+    .start = spi_nop,
+    .stop = spi_nop,
+    .xact = hiz_xact,
+};
+
+// Sniffer never sees any traffic here
+BOOL sniff_active;
+
+struct Bus sniff_bus = {
+    .prompt = "SNIFF",
+    .init = spi_nop,
+    .exit = spi_nop,
+    .start = spi_nop,
+    .stop = spi_nop,
+    .xact = hiz_xact,
+};
@@ -0,0 +1,180 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * I2C master on USI (P1.6 SCL, P1.7 SDA, external pull-ups needed; on
+ * Launchpad remove LED2 jumper). Bus commands map as:
+ *   [ - start, or repeated start if already started
+ *   ] - stop
+ *   <value> - write byte, in duplex mode ({...}) reads back its ACK bit
+ *             (0 = ACK, 1 = NACK)
+ *   r - read byte
+ * ACK for a read byte is sent only when the next operation is known:
+ * another read ACKs it, anything else NACKs it, so r:<n> is one
+ * sequential read of n bytes, and [0xa1 r:64] reads a 24-series EEPROM
+ * page in one transaction.
+ */
+#include "i2c.h"
+#include "cpu.h"
+#include "stats.h"
+
+#if CONFIG_I2C
+
+uint32_t i2c_speed = 100000;
+
+static BOOL active;
+static BOOL started;
+static BOOL ack_pending;    // last read byte still waits for (N)ACK
+static uint16_t scl_period; // in SMCLK cycles
+
+// Returns actual SCL frequency, the highest possible up to i2c_speed
+uint32_t i2c_configure(void)
+{
+    uint8_t div = 0;
+
+    // Divider is a power of 2, up to 128
+    while (div < 7 && (cpu_hz >> div) > i2c_speed)
+        div++;
+    scl_period = 1 << div;
+
+    if (active) {
+        USICTL0 |= USISWRST;
+        // SMCLK / 2^div, SCL idle high
+        USICKCTL = (div << 5) | USISSEL_2 | USICKPL;
+        USICTL0 &= ~USISWRST;
+        // Release SCL
+        USICTL1 &= ~USIIFG;
+    }
+    return cpu_hz >> div;
+}
+
+static void i2c_init(void)
+{
+    P1OUT &= ~(SCL | SDA);
+    P1DIR &= ~(SCL | SDA);
+    USICTL0 = USIPE6 | USIPE7 | USIMST | USISWRST;
+    USICTL1 = USII2C;
+    active = TRUE;
+    started = FALSE;
+    ack_pending = FALSE;
+    i2c_configure();
+}
+
+static void i2c_exit(void)
+{
+    active = FALSE;
+    USICTL0 = USISWRST;
+    USICTL1 = 0;
+}
+
+// Shift out/in given number of bits, SCL is held low afterwards
+static void shift(uint8_t bits)
+{
+    USICNT = bits;
+    while (!(USICTL1 & USIIFG));
+}
+
+// Set SDA directly, through transparent output latch
+static void sda_latch(uint8_t level)
+{
+    USISRL = level;
+    USICTL0 |= USIGE | USIOE;
+    USICTL0 &= ~USIGE;
+}
+
+// Release SCL held low after last bit, and let it settle high
+static void scl_release(void)
+{
+    USICTL1 &= ~USIIFG;
+    cpu_delay_cycles(scl_period);
+}
+
+static void send_ack(BOOL ack)
+{
+    USICTL0 |= USIOE;
+    USISRL = ack ? 0x00 : 0xFF;
+    shift(1);
+    ack_pending = FALSE;
+}
+
+static void i2c_start(void)
+{
+    if (ack_pending)
+        send_ack(FALSE);
+    if (started) {
+        // Repeated start: SDA high while SCL is low, then SCL high
+        sda_latch(0xFF);
+        scl_release();
+    }
+    // SDA goes low while SCL is high
+    sda_latch(0x00);
+    cpu_delay_cycles(scl_period);
+    started = TRUE;
+}
+
+static void i2c_stop(void)
+{
+    if (!started)
+        return;
+    if (ack_pending)
+        send_ack(FALSE);
+    // SDA low while SCL is low, SCL high, then SDA high
+    sda_latch(0x00);
+    scl_release();
+    sda_latch(0xFF);
+    USICTL0 &= ~USIOE;
+    started = FALSE;
+}
+
+// Write byte, returns its ACK bit
+static uint8_t i2c_write(uint8_t c)
+{
+    if (ack_pending)
+        send_ack(TRUE);
+    USICTL0 |= USIOE;
+    USISRL = c;
+    shift(8);
+    USICTL0 &= ~USIOE;
+    shift(1);
+#if CONFIG_STATS
+    stats.bus_bytes[BUS_I2C]++;
+#endif
+    return USISRL & 0x01;
+}
+
+static uint8_t i2c_read(void)
+{
+    if (ack_pending)
+        send_ack(TRUE);
+    USICTL0 &= ~USIOE;
+    shift(8);
+    ack_pending = TRUE;
+#if CONFIG_STATS
+    stats.bus_bytes[BUS_I2C]++;
+#endif
+    return USISRL;
+}
+
+struct Bus i2c_bus = {
+    .prompt = "I2C",
+    .init = i2c_init,
+    .exit = i2c_exit,
+    .start = i2c_start,
+    .stop = i2c_stop,
+    .xact = i2c_write,
+    .read = i2c_read,
+};
+
+#endif
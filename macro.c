@@ -0,0 +1,135 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#include "common.h"
+#include "cpu.h"
+#include "uart.h"
+#include "shell.h"
+#include "macro.h"
+#include <string.h>
+
+// Segment D, C and B are contiguous
+#ifndef MACRO_BASE
+#define MACRO_BASE ((uint8_t *)0x1000)
+#endif
+#define MACRO_SEG(n) (MACRO_BASE + (n) * MACRO_SIZ)
+
+// Flash timing generator must run at 257-476kHz, aim at ~350kHz
+#define FLASH_CLK 350000
+
+/*
+ * CPU is held while flash is busy, and interrupt handlers live in flash
+ * too, so everything is done with interrupts off. Pending output is sent
+ * first; input arriving meanwhile may be lost (erase takes ~12ms).
+ */
+static void flash_unlock(void)
+{
+    uart_flush();
+    dint();
+    FCTL2 = FWKEY + FSSEL_1 + (uint8_t)((cpu_hz + FLASH_CLK - 1) / FLASH_CLK - 1);
+    FCTL3 = FWKEY;
+}
+
+static void flash_lock(void)
+{
+    FCTL1 = FWKEY;
+    FCTL3 = FWKEY + LOCK;
+    eint();
+}
+
+static void seg_erase(uint8_t *seg)
+{
+    FCTL1 = FWKEY + ERASE;
+    *seg = 0; // Dummy write starts erase
+}
+
+static void seg_write(uint8_t *p, uint8_t c)
+{
+    FCTL1 = FWKEY + WRT;
+    *p = c;
+}
+
+// Returns command line of macro n, or NULL if it isn't defined
+const uint8_t *macro_get(uint8_t n)
+{
+    const uint8_t *seg = MACRO_SEG(n);
+
+    if (n >= MACRO_NUM || (*seg & MACRO_DEFINED))
+        return NULL;
+    return seg + 1;
+}
+
+BOOL macro_is_auto(uint8_t n)
+{
+    uint8_t f = *MACRO_SEG(n);
+    return !(f & MACRO_AUTO) && (f & MACRO_NOAUTO);
+}
+
+BOOL macro_define(uint8_t n, const uint8_t *s, BOOL autorun)
+{
+    uint8_t *p = MACRO_SEG(n);
+    uint8_t i;
+
+    if (n >= MACRO_NUM || strlen((const char *)s) > MACRO_LEN)
+        return FALSE;
+    // Only one macro runs at boot
+    if (autorun)
+        macro_auto_off();
+
+    flash_unlock();
+    seg_erase(p);
+    seg_write(p++, ~(MACRO_DEFINED | (autorun ? MACRO_AUTO : 0)));
+    for (i = 0; s[i]; i++)
+        seg_write(p++, s[i]);
+    seg_write(p, 0);
+    flash_lock();
+    return TRUE;
+}
+
+void macro_del(uint8_t n)
+{
+    if (n >= MACRO_NUM)
+        return;
+    flash_unlock();
+    seg_erase(MACRO_SEG(n));
+    flash_lock();
+}
+
+void macro_auto_off(void)
+{
+    uint8_t n;
+
+    for (n = 0; n < MACRO_NUM; n++) {
+        if (macro_is_auto(n)) {
+            flash_unlock();
+            seg_write(MACRO_SEG(n), *MACRO_SEG(n) & ~MACRO_NOAUTO);
+            flash_lock();
+        }
+    }
+}
+
+// Run boot macro, if any. Needs interrupts enabled for output.
+void macro_autorun(void)
+{
+    uint8_t n;
+
+    for (n = 0; n < MACRO_NUM; n++) {
+        const uint8_t *s = macro_get(n);
+        if (s && macro_is_auto(n)) {
+            shell_eval(s, strlen((const char *)s));
+            return;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef MACRO_H
+#define MACRO_H 1
+
+#include "common.h"
+
+/*
+ * Command line macros kept in information memory segments D, C and B
+ * (segment A holds DCO calibration and is never touched). Each 64-byte
+ * segment is a flags byte followed by NUL-terminated command line.
+ */
+#define MACRO_NUM   3
+#define MACRO_SIZ   64
+#define MACRO_LEN   (MACRO_SIZ - 2) // max command line length
+
+// Flags byte, bits are active low so they can be cleared without erase
+#define MACRO_DEFINED   0x01
+#define MACRO_AUTO      0x02    // run at boot...
+#define MACRO_NOAUTO    0x04    // ...unless this is cleared too
+
+const uint8_t *macro_get(uint8_t n);
+BOOL macro_is_auto(uint8_t n);
+BOOL macro_define(uint8_t n, const uint8_t *s, BOOL autorun);
+void macro_del(uint8_t n);
+void macro_auto_off(void);
+void macro_autorun(void);
+
+#endif
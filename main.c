@@ -19,10 +19,64 @@
 #include "console.h"
 #include "shell.h"
 #include "spi.h"
+#include "macro.h"
+#include "event.h"
+#include "capture.h"
+#include "sniff.h"
 
-void driver_tick(void)
+volatile uint8_t events;
+
+// Handle pending events from mask
+void event_run(uint8_t mask)
+{
+    uint8_t ev;
+
+    dint();
+    ev = events & mask;
+    events &= ~ev;
+    eint();
+
+    if (ev & EV_UART_RX)
+        console_tick();
+    if (ev & EV_BUS)
+        shell_bus_tick();
+}
+
+#if CONFIG_EDGES || CONFIG_SNIFF
+// Pin-change interrupts are shared, each handler checks its own pins
+interrupt(PORT1_VECTOR) PORT1_ISR(void)
 {
-    console_tick();
+#if CONFIG_SNIFF
+    sniff_cs_irq();
+#endif
+#if CONFIG_EDGES
+    edges_irq(&P1IN);
+#endif
+}
+#endif
+
+#if CONFIG_EDGES
+interrupt(PORT2_VECTOR) PORT2_ISR(void)
+{
+    edges_irq(&P2IN);
+}
+#endif
+
+void event_loop(void)
+{
+    while (1) {
+        // Interrupt may still come in the instruction after dint
+        dint();
+        nop();
+        if (!events) {
+            // Enable interrupts and sleep in one instruction, so an
+            // event posted right before can't be missed
+            _BIS_SR(LPM0_bits | GIE);
+            continue;
+        }
+        eint();
+        event_run(0xFF);
+    }
 }
 
 int main(void)
@@ -33,10 +87,10 @@ int main(void)
     shell_init();
       
     eint();
+#if CONFIG_MACRO
+    macro_autorun();
+#endif
 
-    while(1)
-    {
-        driver_tick();
-    }
+    event_loop();
 }
 
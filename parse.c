@@ -18,8 +18,8 @@
 #include <string.h>
 
 
-// hex nibble to int
-static int8_t digit_to_int(int8_t ch)
+// hex nibble to int, > 15 if not a hex digit
+int8_t parse_digit(int8_t ch)
 {
     if (ch >= 'a')
         ch -= 'a' - 'A';
@@ -33,31 +33,67 @@ static int8_t digit_to_int(int8_t ch)
     return ch - 7;
 }
 
+// "0x"/"0b" prefix to base
+static uint8_t parse_base(const uint8_t **s)
+{
+    const uint8_t *p = *s;
+
+    if (*p == '0') {
+        if (p[1] == 'b') {
+            *s += 2;
+            return 2;
+        } else if (p[1] == 'x') {
+            *s += 2;
+            return 16;
+        }
+    }
+    return 10;
+}
+
 const uint8_t *parse_number_str(const uint8_t *s, uint16_t *result)
 {
-    uint8_t base = 10;
+    uint8_t base = parse_base(&s);
     uint8_t digit;
 
     *result = 0;
 
-    if (*s == '0') {
-        if (s[1] == 'b') {
-            base = 2;
-        } else if (s[1] == 'x') {
-            base = 16;
-        } else {
-            goto out;
-        }
-        s += 2;
+    while (1) {
+        digit = parse_digit(*s);
+
+        if (digit >= base)
+            return s;
+        *result = (*result) * base + digit;
+        s++;
     }
-out:
+}
+
+const uint8_t *parse_number_str32(const uint8_t *s, uint32_t *result)
+{
+    uint8_t base = parse_base(&s);
+    uint8_t digit;
+
+    *result = 0;
 
     while (1) {
-        digit = digit_to_int(*s);
+        digit = parse_digit(*s);
 
-        if (digit > base)
+        if (digit >= base)
             return s;
         *result = (*result) * base + digit;
         s++;
     }
 }
+
+// Number with optional "k" or "M" multiplier suffix, e.g. 400k
+const uint8_t *parse_freq_str(const uint8_t *s, uint32_t *result)
+{
+    s = parse_number_str32(s, result);
+    if (*s == 'k') {
+        *result *= 1000;
+        s++;
+    } else if (*s == 'M') {
+        *result *= 1000000;
+        s++;
+    }
+    return s;
+}
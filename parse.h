@@ -18,7 +18,10 @@
 
 #include "common.h"
 
+int8_t parse_digit(int8_t ch);
 const uint8_t *parse_number_str(const uint8_t *str, uint16_t *result);
+const uint8_t *parse_number_str32(const uint8_t *str, uint32_t *result);
+const uint8_t *parse_freq_str(const uint8_t *str, uint32_t *result);
 
 #endif
 
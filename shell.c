@@ -19,11 +19,47 @@
 #include "shell.h"
 #include "hiz.h"
 #include "spi.h"
+#include "bbspi.h"
+#include "i2c.h"
+#include "sniff.h"
+#include "binmode.h"
+#include "flash.h"
+#include "crc.h"
+#include "uart.h"
+#include "macro.h"
+#include "stats.h"
+#include "capture.h"
 #include <ctype.h>
 
 // Use duplex mode for bus transfers
 static char duplex;
-static struct Bus *buses[] = {&hiz_bus, &spi_bus};
+#if CONFIG_PAYLOAD
+// w"..." payload state, it may span several lines
+static BOOL payload_open;
+static uint8_t payload_mode;
+enum {
+    PAYLOAD_BUS,    // w"..." - write to the bus
+    PAYLOAD_FLASH,  // flash write - feed flash_write_byte()
+    PAYLOAD_VERIFY, // v"..." - read and compare
+};
+static uint32_t payload_mismatches;
+static int8_t payload_nibble; // high nibble of incomplete byte or -1
+static uint32_t payload_count;
+static crc_t payload_crc;
+#endif
+static struct Bus *buses[] = {
+    &hiz_bus,
+    &spi_bus,
+#if CONFIG_BBSPI
+    &bbspi_bus,
+#endif
+#if CONFIG_I2C
+    &i2c_bus,
+#endif
+#if CONFIG_SNIFF
+    &sniff_bus,
+#endif
+};
 static struct Bus *current_bus;
 
 static void set_bus(int bus)
@@ -40,6 +76,22 @@ void shell_init(void)
     set_bus(BUS_HIZ);
 }
 
+void shell_bus_tick(void)
+{
+    if (current_bus->tick)
+        current_bus->tick();
+}
+
+#if CONFIG_BINMODE
+void shell_binmode(void)
+{
+    // Binary mode starts and ends in HiZ state, like on Bus Pirate
+    set_bus(BUS_HIZ);
+    binmode_run();
+    set_bus(BUS_HIZ);
+}
+#endif
+
 static const uint8_t *syntax_error()
 {
     console_puts("BadCmd");
@@ -47,46 +99,124 @@ static const uint8_t *syntax_error()
     return NULL;
 }
 
-static void bus_spi_start(void)
+static void report_start(void)
 {
-    current_bus->start();
-
+    if (console_quiet || console_out == OUT_RAW)
+        return;
+    if (console_out != OUT_VERBOSE) {
+        console_putmark('[');
+        return;
+    }
+#if CONFIG_I2C
+    if (current_bus == &i2c_bus)
+        console_puts("I2C START");
+    else
+#endif
     console_puts("CS ENABLED");
     console_newline();
 }
 
-static void bus_spi_stop(void)
+static void report_stop(void)
 {
-    current_bus->stop();
-
+    if (console_quiet || console_out == OUT_RAW)
+        return;
+    if (console_out != OUT_VERBOSE) {
+        console_putmark(']');
+        return;
+    }
+#if CONFIG_I2C
+    if (current_bus == &i2c_bus)
+        console_puts("I2C STOP");
+    else
+#endif
     console_puts("CS DISABLED");
     console_newline();
 }
 
 static void bus_dump_read(uint8_t c)
 {
+    if (console_out != OUT_VERBOSE) {
+        console_putdata(c);
+        return;
+    }
     console_puts("READ: 0x");
     console_puthex8(c);
     console_newline();
 }
 
-static void bus_spi_write(uint8_t c)
+static void report_write(uint8_t c)
 {
-    uint8_t r = current_bus->xact(c);
+    if (console_quiet) {
+    } else if (console_out == OUT_RAW) {
+        console_putc(c);
+    } else if (console_out != OUT_VERBOSE) {
+        console_putmark('w');
+        console_puthex8(c);
+    } else {
+        console_puts("WRITE: 0x");
+        console_puthex8(c);
+        console_newline();
+    }
+}
 
-    console_puts("WRITE: 0x");
-    console_puthex8(c);
-    console_newline();
-    if (duplex)
-        bus_dump_read(r);
+// Transfers over 8 bits are shown as 16-bit values
+static void report_write_bits(uint16_t c, uint8_t bits)
+{
+    if (bits <= 8) {
+        report_write(c);
+        return;
+    }
+    if (console_quiet) {
+    } else if (console_out == OUT_RAW) {
+        console_putc(c >> 8);
+        console_putc(c);
+    } else if (console_out != OUT_VERBOSE) {
+        console_putmark('w');
+        console_puthex16(c);
+    } else {
+        console_puts("WRITE: 0x");
+        console_puthex16(c);
+        console_newline();
+    }
+}
+
+static void report_read_bits(uint16_t c, uint8_t bits)
+{
+    if (bits <= 8) {
+        bus_dump_read(c);
+    } else if (console_out == OUT_RAW) {
+        console_putc(c >> 8);
+        console_putc(c);
+    } else if (console_out != OUT_VERBOSE) {
+        console_putmark(0);
+        console_puthex16(c);
+    } else {
+        console_puts("READ: 0x");
+        console_puthex16(c);
+        console_newline();
+    }
 }
 
-static void bus_spi_read(void)
+#if CONFIG_CRC
+/*
+ * r:<n>c - read n bytes, print them followed by their CRC,
+ * r:<n>C - same, but print only the CRC.
+ */
+static void bus_crc_read(uint16_t repeat, BOOL crc_only)
 {
+    crc_t crc = CRC_INIT;
     uint8_t c;
-    c = current_bus->xact(0xFF);
-    bus_dump_read(c);
+
+    while (repeat--) {
+        c = bus_read(current_bus);
+        crc = crc_update(crc, c);
+        if (!crc_only)
+            bus_dump_read(c);
+    }
+    console_endline();
+    crc_report(crc);
 }
+#endif
 
 BOOL match(const uint8_t *s, char *pat)
 {
@@ -97,141 +227,1195 @@ BOOL match(const uint8_t *s, char *pat)
     return TRUE;
 }
 
-const uint8_t *eval_pin_command(const uint8_t *s)
+#if CONFIG_PAYLOAD
+#if CONFIG_VERIFY
+// Read one byte and report it only if it's not the expected one
+static void verify_byte(uint8_t expected)
 {
-    // Set port pin command
-    uint8_t mask;
-    volatile uint8_t *port;
+    uint8_t r = bus_read(current_bus);
 
-    if (s[2] != '.')
-        return syntax_error();
+    if (r != expected) {
+        payload_mismatches++;
+        console_endline();
+        console_puts("MISMATCH: ");
+        console_putdec(payload_count);
+        console_puts(" EXP: 0x");
+        console_puthex8(expected);
+        console_puts(" GOT: 0x");
+        console_puthex8(r);
+        console_newline();
+    }
+    payload_count++;
+}
+#endif
+
+/*
+ * End payload early, on bad input or failed flash write, so following
+ * lines are commands again. Ends the bus transaction too. Returns end of
+ * line, the rest of it is skipped.
+ */
+static const uint8_t *abort_payload(const uint8_t *s)
+{
+    payload_open = FALSE;
+    console_endline();
+#if CONFIG_FLASH
+    if (payload_mode == PAYLOAD_FLASH) {
+        flash_write_abort();
+    } else
+#endif
+    {
+        current_bus->stop();
+        duplex = 0;
+        report_stop();
+    }
+    while (*s)
+        s++;
+    return s;
+}
+
+/*
+ * Hex bytes of w"..." command, written to the bus without per-byte
+ * parsing and reporting. Spaces are ignored, line end means payload
+ * continues on the next line. Closing quote reports count and CRC of
+ * bytes written. A bad character aborts the payload (see
+ * abort_payload()). Same format is used for v"..." expected data and
+ * "flash write".
+ */
+static const uint8_t *eval_payload(const uint8_t *s)
+{
+    int8_t d;
+    uint8_t r;
+
+    for (; *s; s++) {
+        if (*s == '"') {
+            payload_open = FALSE;
+            if (payload_nibble >= 0)
+                syntax_error();
+            console_endline();
+#if CONFIG_FLASH
+            if (payload_mode == PAYLOAD_FLASH) {
+                flash_write_end();
+                return s + 1;
+            }
+#endif
+#if CONFIG_VERIFY
+            if (payload_mode == PAYLOAD_VERIFY) {
+                if (payload_mismatches) {
+                    console_puts("VERIFY FAIL: ");
+                    console_putdec(payload_mismatches);
+                    console_putc('/');
+                } else {
+                    console_puts("VERIFY OK: ");
+                }
+                console_putdec(payload_count);
+                console_newline();
+                return s + 1;
+            }
+#endif
+            console_puts("WROTE: ");
+            console_putdec(payload_count);
+            console_newline();
+            crc_report(payload_crc);
+            return s + 1;
+        }
+        if (*s == ' ')
+            continue;
+        d = parse_digit(*s);
+        if (d > 15) {
+            syntax_error();
+            return abort_payload(s);
+        } else if (payload_nibble < 0) {
+            payload_nibble = d;
+        } else {
+            d |= payload_nibble << 4;
+            payload_nibble = -1;
+#if CONFIG_FLASH
+            if (payload_mode == PAYLOAD_FLASH) {
+                // abort_payload() reports the failure
+                if (!flash_write_byte(d))
+                    return abort_payload(s);
+                continue;
+            }
+#endif
+#if CONFIG_VERIFY
+            if (payload_mode == PAYLOAD_VERIFY) {
+                verify_byte(d);
+                continue;
+            }
+#endif
+            r = current_bus->xact(d);
+            payload_count++;
+            payload_crc = crc_update(payload_crc, d);
+            if (duplex)
+                bus_dump_read(r);
+        }
+    }
+    payload_open = TRUE;
+    return s;
+}
+
+static const uint8_t *start_payload(const uint8_t *s, uint8_t mode)
+{
+    payload_mode = mode;
+    payload_mismatches = 0;
+    payload_nibble = -1;
+    payload_count = 0;
+    payload_crc = CRC_INIT;
+    return eval_payload(s);
+}
+#endif
+
+#if CONFIG_MACRO
+/*
+ * macro - list macros
+ * macro def <n> <line> - store command line as macro n
+ * macro auto <n> <line> - same, and run it at boot
+ * macro auto off - don't run anything at boot
+ * macro del <n>
+ */
+static void eval_macro_command(const uint8_t *s)
+{
+    uint8_t n;
+    BOOL autorun = match(s, " auto ");
+
+    if (!*s) {
+        for (n = 0; n < MACRO_NUM; n++) {
+            const uint8_t *m = macro_get(n);
+            if (!m)
+                continue;
+            console_putc('@');
+            console_putc('0' + n);
+            if (macro_is_auto(n))
+                console_putc('*');
+            console_puts(": ");
+            console_puts((const char *)m);
+            console_newline();
+        }
+        return;
+    }
+    if (autorun && match(s + 6, "off")) {
+        macro_auto_off();
+        return;
+    }
+    if (autorun || match(s, " def ")) {
+        s += autorun ? 6 : 5;
+        n = *s - '0';
+        if (s[1] == ' ' && macro_define(n, s + 2, autorun))
+            return;
+    } else if (match(s, " del ")) {
+        n = s[5] - '0';
+        if (n < MACRO_NUM && !s[6]) {
+            macro_del(n);
+            return;
+        }
+    }
+    syntax_error();
+}
+#endif
+
+#if CONFIG_POLL
+/*
+ * ?mask=value[:timeout_ms] - read bytes until (byte & mask) == value,
+ * report only the last byte and number of reads.
+ */
+static const uint8_t *parse_poll(const uint8_t *s, uint16_t *mask,
+                                 uint16_t *value, uint16_t *timeout)
+{
+    *timeout = 1000;
+    s = parse_number_str(s + 1, mask);
+    if (*s != '=')
+        return NULL;
+    s = parse_number_str(s + 1, value);
+    if (*s == ':')
+        s = parse_number_str(s + 1, timeout);
+    return s;
+}
 
-    mask = 1 << (s[3] - '0');
+static void run_poll(const uint8_t *s)
+{
+    uint16_t mask, value, timeout;
+    struct BusPoll res;
+    BOOL ok;
+
+    parse_poll(s, &mask, &value, &timeout);
+    ok = bus_poll(current_bus, mask, value, timeout, &res);
+
+    console_endline();
+    console_puts(ok ? "POLL: 0x" : "TIMEOUT: 0x");
+    console_puthex8(res.value);
+    console_puts(" COUNT: ");
+    console_putdec(res.count);
+    console_newline();
+}
+#endif
+
+/*
+ * Bus command lines are compiled to a list of ops first, so syntax errors
+ * are caught before anything goes to the bus, and the list is then run in
+ * a tight loop: bytes within [...] go out back to back, and are reported
+ * afterwards from saved read data. Without CONFIG_COMPILE the list holds
+ * just one op, so each is run and reported right after it's parsed.
+ */
+enum {
+    OP_START,       // [ or {, value is TRUE for {
+    OP_STOP,        // ] or }
+    OP_WRITE,       // <value>:<repeat>
+    OP_XFER,        // same within {...}, read data is reported too
+    OP_READ,        // r:<repeat>
+    OP_WRITE_BITS,  // <value>.<bits>:<repeat>, same via bus->xact_bits()
+    OP_XFER_BITS,
+    OP_READ_BITS,   // r.<bits>:<repeat>
+    OP_DELAY,       // &:<repeat> microseconds
+    OP_DELAY_MS,    // %:<repeat> milliseconds
+    OP_PIN_LOW,     // pN.M=0, value is pin mask
+    OP_PIN_HIGH,    // pN.M=1
+    OP_PIN_READ,    // pN.M?
+    // Ops below report by themselves
+    OP_CRC_READ,    // r:<repeat>c|C, value is TRUE for CRC only
+    OP_POLL,        // ?mask=value:timeout, parsed again when run
+    OP_PAYLOAD,     // w"..." or v"...", value is PAYLOAD_*
+    OP_MACRO,       // @n, expanded when compiling
+};
+
+struct Op {
+    uint8_t op;
+    uint8_t bits;   // transfer width for OP_*_BITS
+    uint16_t value;
+    union {
+        uint16_t repeat;
+        const uint8_t *s;           // text for OP_POLL, OP_PAYLOAD, OP_MACRO
+        volatile uint8_t *port;     // PxIN for OP_PIN_*
+    } u;
+};
+
+#if CONFIG_COMPILE
+#define OPS_MAX     16
+#define RESULTS_SIZ 16
+#else
+#define OPS_MAX     1
+#define RESULTS_SIZ 2 // one 16-bit transfer
+#endif
+
+// Nesting limit for @n, also stops a macro from calling itself forever
+#define MACRO_DEPTH 4
+
+static struct Op ops[OPS_MAX];
+static uint8_t ops_len;
+static uint8_t results[RESULTS_SIZ]; // read data of ops not reported yet
+static BOOL compile_duplex; // duplex state as of the op being compiled
+
+// pN.M, gives PxIN and pin mask
+static const uint8_t *parse_pin(const uint8_t *s, volatile uint8_t **port,
+                                uint8_t *mask)
+{
+    if (s[0] != 'p' || s[2] != '.' || s[3] < '0' || s[3] > '7')
+        return NULL;
+    *mask = 1 << (s[3] - '0');
     switch (s[1]) {
     case '1':
-        port = &P1IN;
+        *port = &P1IN;
         break;
     case '2':
-        port = &P2IN;
+        *port = &P2IN;
         break;
     default:
-        return syntax_error();
+        return NULL;
     }
+    return s + 4;
+}
 
-    if (s[4] == '=') {
-        // PxDIR
-        port[2] |= mask;
-        // PxOUT
-        if (s[5] == '0')
-            port[1] &= ~mask;
-        else
-            port[1] |= mask;
-        s += 6;
-    } else if (s[4] == '?') {
-        // PxDIR
-        port[2] &= ~mask;
-        console_puts("READ: ");
-        // PxIN
-        if (port[0] & mask)
-            console_putc('1');
-        else
-            console_putc('0');
-        console_newline();
-        s += 5;
+// pN.M=0|1 or pN.M?
+static const uint8_t *compile_pin(const uint8_t *s, struct Op *op)
+{
+    uint8_t mask;
+
+    if (!parse_pin(s, &op->u.port, &mask))
+        return NULL;
+    op->value = mask;
+
+    if (s[4] == '?') {
+        op->op = OP_PIN_READ;
+        return s + 5;
     }
-    return s;
+    if (s[4] != '=' || (s[5] != '0' && s[5] != '1'))
+        return NULL;
+    op->op = s[5] == '0' ? OP_PIN_LOW : OP_PIN_HIGH;
+    return s + 6;
 }
 
-const uint8_t *eval_single_bus_command(const uint8_t *s);
-void eval_bus_commands(const uint8_t *s)
+#if CONFIG_PAYLOAD
+// Skip payload up to and including closing quote (if it's on this line)
+static const uint8_t *compile_payload(const uint8_t *s)
 {
-    while (*s) {
-        if (*s == ' ' || *s == '\t' || *s == ',') {
-            s++;
+    uint8_t digits = 0;
+
+    for (; *s != '"'; s++) {
+        if (!*s)
+            return s;
+        if (*s == ' ')
             continue;
-        }
-        if (!(s = eval_single_bus_command(s))) {
-            break;
-        }
+        if (parse_digit(*s) > 15)
+            return NULL;
+        digits++;
     }
+    return digits & 1 ? NULL : s + 1;
 }
+#endif
 
-
-const uint8_t *eval_single_bus_command(const uint8_t *s)
+// Parse one command, returns pointer past it or NULL on syntax error
+static const uint8_t *compile_op(const uint8_t *s, struct Op *op)
 {
     uint16_t num;
-    uint16_t repeat = 1;
-    uint8_t cmd;
 
-    // Process non-repeatable commands
+    op->u.repeat = 1;
     switch (*s) {
     case '{':
-        duplex = 1;
+        compile_duplex = TRUE;
     case '[':
-        bus_spi_start();
+        op->op = OP_START;
+        op->value = compile_duplex;
         return s + 1;
     case '}':
     case ']':
-        bus_spi_stop();
-        duplex = 0;
+        op->op = OP_STOP;
+        compile_duplex = FALSE;
         return s + 1;
     case 'p':
-        return eval_pin_command(s);
+        return compile_pin(s, op);
+#if CONFIG_POLL
+    case '?':
+        op->op = OP_POLL;
+        op->u.s = s;
+        return parse_poll(s, &num, &num, &num);
+#endif
+#if CONFIG_PAYLOAD
+#if CONFIG_VERIFY
+    case 'v':
+#endif
+    case 'w':
+        if (s[1] != '"')
+            return NULL;
+        op->op = OP_PAYLOAD;
+        op->value = *s == 'w' ? PAYLOAD_BUS : PAYLOAD_VERIFY;
+        op->u.s = s + 2;
+        return compile_payload(s + 2);
+#endif
+#if CONFIG_MACRO
+    case '@':
+        op->op = OP_MACRO;
+        op->u.s = macro_get(s[1] - '0');
+        return op->u.s ? s + 2 : NULL;
+#endif
     }
 
-    // Process repeatable commands
+    // Repeatable commands
     if (isdigit(*s)) {
         s = parse_number_str(s, &num);
-        cmd = '0';
+        op->op = compile_duplex ? OP_XFER : OP_WRITE;
+        op->value = num;
     } else if (*s == 'r') {
-        cmd = *s++;
+        op->op = OP_READ;
+        s++;
     } else if (*s == '&') {
-        cmd = *s++;
+        op->op = OP_DELAY;
+        s++;
+    } else if (*s == '%') {
+        op->op = OP_DELAY_MS;
+        s++;
     } else {
-        return syntax_error();
+        return NULL;
+    }
+
+    // Transfer width, if bus can do it
+    if (*s == '.' && op->op <= OP_READ) {
+        s = parse_number_str(s + 1, &num);
+        if (num < 1 || num > 16 || !current_bus->xact_bits
+                || !(current_bus->widths & (1 << (num - 1))))
+            return NULL;
+        if (num != 8) {
+            op->op += OP_WRITE_BITS - OP_WRITE;
+            op->bits = num;
+        }
     }
 
     if (*s == ':') {
-        s = parse_number_str(s + 1, &repeat);
+        s = parse_number_str(s + 1, &op->u.repeat);
+    }
+
+#if CONFIG_CRC
+    if (op->op == OP_READ && (*s == 'c' || *s == 'C')) {
+        op->op = OP_CRC_READ;
+        op->value = *s++ == 'C';
+    }
+#endif
+    return s;
+}
+
+// Result bytes per repetition of a repeatable op
+static uint8_t op_width(const struct Op *op)
+{
+    switch (op->op) {
+    case OP_XFER:
+    case OP_READ:
+        return 1;
+    case OP_XFER_BITS:
+    case OP_READ_BITS:
+        return op->bits > 8 ? 2 : 1;
+    }
+    return 0;
+}
+
+// Number of result bytes op leaves for report_ops(), can exceed 16 bits
+static uint32_t op_results(const struct Op *op)
+{
+    if (op->op == OP_PIN_READ)
+        return 1;
+    return (uint32_t)op->u.repeat * op_width(op);
+}
+
+// Keep result of 1-16 bit transfer, big endian if it takes 2 bytes
+static uint8_t *put_result(uint8_t *r, uint16_t c, uint8_t bits)
+{
+    if (bits > 8)
+        *r++ = c >> 8;
+    *r++ = c;
+    return r;
+}
+
+// Run op without reporting, read data goes to r. Returns new end of data.
+static uint8_t *run_op(const struct Op *op, uint8_t *r)
+{
+    uint16_t n = op->u.repeat;
+    uint8_t v = op->value;
+
+    switch (op->op) {
+    case OP_START:
+        current_bus->start();
+        duplex = v;
+        break;
+    case OP_STOP:
+        current_bus->stop();
+        duplex = 0;
+        break;
+    case OP_WRITE:
+        while (n--)
+            current_bus->xact(v);
+        break;
+    case OP_XFER:
+        while (n--)
+            *r++ = current_bus->xact(v);
+        break;
+    case OP_READ:
+        while (n--)
+            *r++ = bus_read(current_bus);
+        break;
+    case OP_WRITE_BITS:
+        while (n--)
+            current_bus->xact_bits(op->value, op->bits);
+        break;
+    case OP_XFER_BITS:
+        while (n--)
+            r = put_result(r, current_bus->xact_bits(op->value, op->bits),
+                           op->bits);
+        break;
+    case OP_READ_BITS:
+        while (n--)
+            r = put_result(r, current_bus->xact_bits(0xFFFF, op->bits),
+                           op->bits);
+        break;
+    case OP_DELAY:
+        cpu_delay_us(n);
+        break;
+    case OP_DELAY_MS:
+        cpu_delay_ms(n);
+        break;
+    case OP_PIN_LOW:
+        op->u.port[2] |= v;     // PxDIR
+        op->u.port[1] &= ~v;    // PxOUT
+        break;
+    case OP_PIN_HIGH:
+        op->u.port[2] |= v;
+        op->u.port[1] |= v;
+        break;
+    case OP_PIN_READ:
+        op->u.port[2] &= ~v;
+        *r++ = (op->u.port[0] & v) != 0;
+        break;
+#if CONFIG_CRC
+    case OP_CRC_READ:
+        bus_crc_read(n, v);
+        break;
+#endif
+#if CONFIG_POLL
+    case OP_POLL:
+        run_poll(op->u.s);
+        break;
+#endif
+#if CONFIG_PAYLOAD
+    case OP_PAYLOAD:
+        start_payload(op->u.s, v);
+        break;
+#endif
     }
+    return r;
+}
 
-    while(repeat--) {
-        switch (cmd) {
-        case '0':
-            bus_spi_write((uint8_t)num);
+// Print what ops from..to-1 did, using read data in results[]
+static void report_ops(const struct Op *op, const struct Op *to)
+{
+    const uint8_t *r = results;
+    uint16_t n;
+
+    for (; op < to; op++) {
+        n = op->u.repeat;
+        switch (op->op) {
+        case OP_START:
+            report_start();
             break;
-        case 'r':
-            bus_spi_read();
+        case OP_STOP:
+            report_stop();
+            break;
+        case OP_WRITE:
+        case OP_XFER:
+            while (n--) {
+                report_write(op->value);
+                if (op->op == OP_XFER)
+                    bus_dump_read(*r++);
+            }
+            break;
+        case OP_READ:
+            while (n--)
+                bus_dump_read(*r++);
             break;
-        case '&':
-            //delay_1us();
+        case OP_WRITE_BITS:
+        case OP_XFER_BITS:
+        case OP_READ_BITS:
+            while (n--) {
+                if (op->op != OP_READ_BITS)
+                    report_write_bits(op->value, op->bits);
+                if (op->op == OP_WRITE_BITS)
+                    continue;
+                if (op->bits > 8) {
+                    report_read_bits((uint16_t)r[0] << 8 | r[1], op->bits);
+                    r += 2;
+                } else {
+                    report_read_bits(*r++, op->bits);
+                }
+            }
+            break;
+        case OP_PIN_READ:
+            console_endline();
+            console_puts("READ: ");
+            console_putc('0' + *r++);
+            console_newline();
             break;
         }
     }
+}
+
+static void run_ops(void)
+{
+    const struct Op *op, *end = ops + ops_len;
+    const struct Op *report = ops; // first op not reported yet
+    uint8_t *r = results;
+    uint32_t need;
+#if CONFIG_STATS
+    uint32_t t = cpu_ticks32();
+#endif
+
+    for (op = ops; op < end; op++) {
+        need = op_results(op);
+        if (op->op >= OP_CRC_READ ||
+                need > (uint32_t)(results + RESULTS_SIZ - r)) {
+            // Output of previous ops goes first
+            report_ops(report, op);
+            report = op;
+            r = results;
+        }
+        if (need > RESULTS_SIZ) {
+            // Too much read data to keep, report it in pieces
+            struct Op part = *op;
+            uint16_t n = op->u.repeat;
+            uint8_t max = RESULTS_SIZ / op_width(op);
+            while (n) {
+                part.u.repeat = n < max ? n : max;
+                run_op(&part, results);
+                report_ops(&part, &part + 1);
+                n -= part.u.repeat;
+            }
+            report = op + 1;
+            continue;
+        }
+        r = run_op(op, r);
+        if (op->op >= OP_CRC_READ)
+            report = op + 1;
+    }
+    report_ops(report, end);
+    ops_len = 0;
+#if CONFIG_STATS
+    stats.run += cpu_ticks32() - t;
+#endif
+}
+
+/*
+ * Compile command line into ops[] (running them whenever ops[] fills up),
+ * or only check it if run is FALSE. Macros are expanded inline.
+ */
+static BOOL compile(const uint8_t *s, BOOL run)
+{
+    struct Op tmp, *op;
+
+    while (*s) {
+        if (*s == ' ' || *s == '\t' || *s == ',') {
+            s++;
+            continue;
+        }
+        op = run ? &ops[ops_len] : &tmp;
+        if (!(s = compile_op(s, op)))
+            return FALSE;
+#if CONFIG_MACRO
+        if (op->op == OP_MACRO) {
+            static uint8_t depth;
+            BOOL ok = FALSE;
+
+            if (depth < MACRO_DEPTH) {
+                depth++;
+                ok = compile(op->u.s, run);
+                depth--;
+            }
+            if (!ok)
+                return FALSE;
+            continue;
+        }
+#endif
+        if (run && ++ops_len == OPS_MAX)
+            run_ops();
+    }
+    return TRUE;
+}
+
+void eval_bus_commands(const uint8_t *s)
+{
+#if CONFIG_STATS
+    // Whatever isn't spent in run_ops() is parsing
+    uint32_t t = cpu_ticks32() - stats.run;
+#endif
+
+    // Nothing is run if there's an error anywhere in the line
+    compile_duplex = duplex;
+    if (!compile(s, FALSE)) {
+        syntax_error();
+        return;
+    }
+    compile_duplex = duplex;
+    compile(s, TRUE);
+    run_ops();
+#if CONFIG_STATS
+    stats.parse += cpu_ticks32() - t - stats.run;
+#endif
+}
+
+#if CONFIG_SPI_CONFIG
+// spi [speed <hz>[k|M]] [mode 0-3] [lsb|msb]
+static void eval_spi_config(const uint8_t *s)
+{
+    if (current_bus != &spi_bus)
+        set_bus(BUS_SPI);
+
+    while (*s) {
+        if (*s == ' ') {
+            s++;
+        } else if (match(s, "speed ")) {
+            s = parse_freq_str(s + 6, &spi_speed);
+        } else if (match(s, "mode ") && s[5] >= '0' && s[5] <= '3') {
+            spi_mode = s[5] - '0';
+            s += 6;
+        } else if (match(s, "lsb")) {
+            spi_lsb = TRUE;
+            s += 3;
+        } else if (match(s, "msb")) {
+            spi_lsb = FALSE;
+            s += 3;
+        } else {
+            syntax_error();
+            return;
+        }
+    }
+
+    console_puts("SCLK: ");
+    console_putdec(spi_configure());
+    console_puts(" Hz");
+    console_newline();
+}
+#endif
+
+#if CONFIG_I2C
+// i2c [speed <hz>[k|M]]
+static void eval_i2c_config(const uint8_t *s)
+{
+    while (*s) {
+        if (*s == ' ') {
+            s++;
+        } else if (match(s, "speed ")) {
+            s = parse_freq_str(s + 6, &i2c_speed);
+        } else {
+            syntax_error();
+            return;
+        }
+    }
+
+    if (current_bus != &i2c_bus)
+        set_bus(BUS_I2C);
+    console_puts("SCL: ");
+    console_putdec(i2c_configure());
+    console_puts(" Hz");
+    console_newline();
+}
+#endif
+
+#if CONFIG_SNIFF
+// sniff [mode 0-3] [lsb|msb], shared with "spi"
+static void eval_sniff_config(const uint8_t *s)
+{
+    while (*s) {
+        if (*s == ' ') {
+            s++;
+        } else if (match(s, "mode ") && s[5] >= '0' && s[5] <= '3') {
+            spi_mode = s[5] - '0';
+            s += 6;
+        } else if (match(s, "lsb")) {
+            spi_lsb = TRUE;
+            s += 3;
+        } else if (match(s, "msb")) {
+            spi_lsb = FALSE;
+            s += 3;
+        } else {
+            syntax_error();
+            return;
+        }
+    }
+    // (Re)init with new settings
+    set_bus(BUS_SNIFF);
+}
+#endif
+
+#if CONFIG_BBSPI
+static const char *const bbspi_pin_names[BB_PINS] = {
+    "sclk ", "mosi ", "miso ", "cs "
+};
+
+// bbspi [sclk|mosi|miso|cs pN.M] [mode 0-3]
+static void eval_bbspi_config(const uint8_t *s)
+{
+    uint8_t pins[BB_PINS], mode = bbspi_mode, i;
+
+    for (i = 0; i < BB_PINS; i++)
+        pins[i] = bbspi_pins[i];
+
+    while (*s) {
+        if (*s == ' ') {
+            s++;
+            continue;
+        }
+        if (match(s, "mode ") && s[5] >= '0' && s[5] <= '3') {
+            mode = s[5] - '0';
+            s += 6;
+            continue;
+        }
+        for (i = 0; i < BB_PINS; i++) {
+            if (match(s, (char *)bbspi_pin_names[i]))
+                break;
+        }
+        if (i == BB_PINS) {
+            syntax_error();
+            return;
+        }
+        while (*s++ != ' ');
+        if (s[0] != 'p' || !isdigit(s[1]) || s[2] != '.' || !isdigit(s[3])) {
+            syntax_error();
+            return;
+        }
+        pins[i] = ((s[1] - '0') << 4) | (s[3] - '0');
+        if (!bbspi_pin_ok(pins[i])) {
+            syntax_error();
+            return;
+        }
+        s += 4;
+    }
+
+    // Nothing changes unless the whole line is valid
+    if (!bbspi_configure(pins, mode)) {
+        syntax_error();
+        return;
+    }
+    if (current_bus != &bbspi_bus)
+        set_bus(BUS_BBSPI);
+
+    for (i = 0; i < BB_PINS; i++) {
+        console_puts(bbspi_pin_names[i]);
+        console_putc('p');
+        console_putc('0' + (bbspi_pins[i] >> 4));
+        console_putc('.');
+        console_putc('0' + (bbspi_pins[i] & 7));
+        console_putc(' ');
+    }
+    console_puts("mode ");
+    console_putc('0' + bbspi_mode);
+    console_newline();
+}
+#endif
+
+#if CONFIG_CAPTURE
+/*
+ * capture [p1|p2] [mask <m>] [rate <hz>[k|M]] [n <samples>]
+ *         [trigger pN.M rise|fall]
+ */
+static void eval_capture_command(const uint8_t *s)
+{
+    struct Capture c = {
+        .port = &P1IN,
+        .mask = 0xFF,
+        .rate = 10000,
+        .count = CAPTURE_BUF_SIZ,
+    };
+    uint16_t v;
+
+    while (*s) {
+        if (*s == ' ') {
+            s++;
+        } else if (match(s, "p1")) {
+            c.port = &P1IN;
+            s += 2;
+        } else if (match(s, "p2")) {
+            c.port = &P2IN;
+            s += 2;
+        } else if (match(s, "mask ")) {
+            s = parse_number_str(s + 5, &v);
+            c.mask = v;
+        } else if (match(s, "rate ")) {
+            s = parse_freq_str(s + 5, &c.rate);
+        } else if (match(s, "n ")) {
+            s = parse_number_str(s + 2, &c.count);
+        } else if (match(s, "trigger ")) {
+            s = parse_pin(s + 8, &c.trig_port, &c.trig_mask);
+            if (!s)
+                break;
+            if (match(s, " rise")) {
+                c.trig_rise = TRUE;
+                s += 5;
+            } else if (match(s, " fall")) {
+                s += 5;
+            } else {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+
+    if (s == NULL || *s || c.count == 0 || c.count > CAPTURE_BUF_SIZ ||
+            c.rate == 0 || !capture_run(&c))
+        syntax_error();
+}
+#endif
+
+#if CONFIG_EDGES
+// edges [p1|p2] [mask <m>] | edges off
+static void eval_edges_command(const uint8_t *s)
+{
+    volatile uint8_t *port = &P1IN;
+    uint16_t mask = 0xFF;
+
+    if (match(s, " off")) {
+        edges_stop();
+        return;
+    }
+    while (*s) {
+        if (*s == ' ') {
+            s++;
+        } else if (match(s, "p1")) {
+            port = &P1IN;
+            s += 2;
+        } else if (match(s, "p2")) {
+            port = &P2IN;
+            s += 2;
+        } else if (match(s, "mask ")) {
+            s = parse_number_str(s + 5, &mask);
+        } else {
+            syntax_error();
+            return;
+        }
+    }
+    edges_start(port, mask);
+}
+#endif
+
+// Needed to compare bitbang SPI with hardware, even without "stats"
+#if CONFIG_BBSPI || CONFIG_STATS
+/*
+ * bench [n] - time n byte reads (default 1000) on current bus, with
+ * CS asserted, to compare raw throughput of bus implementations.
+ */
+static void eval_bench(const uint8_t *s)
+{
+    uint16_t i, n = 1000;
+    uint32_t t;
+
+    if (*s == ' ')
+        parse_number_str(s + 1, &n);
+    if (n == 0) {
+        syntax_error();
+        return;
+    }
+
+    if (current_bus->start)
+        current_bus->start();
+    t = cpu_ticks32();
+    for (i = 0; i < n; i++)
+        bus_read(current_bus);
+    t = cpu_ticks32() - t;
+    if (current_bus->stop)
+        current_bus->stop();
+
+    console_puts("BENCH: ");
+    console_putdec(n);
+    console_puts(" bytes ");
+    console_putudec(t);
+    console_puts(" cycles ");
+    // cycles/byte in 1/16ths, so slow buses don't lose precision; split
+    // in quotient and remainder so it doesn't overflow for long runs
+    t = t / n * 16 + t % n * 16 / n;
+    console_putdec(cpu_hz * 16 / (t ? t : 1));
+    console_puts(" B/s");
+    console_newline();
+}
+#endif
+
+#if CONFIG_STATS
+static void print_stat(const char *name, uint32_t val)
+{
+    console_puts(name);
+    console_puts(": ");
+    console_putudec(val);
+    console_newline();
+}
+
+// Cycles are SMCLK ones
+static void print_stats(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < BUS_COUNT; i++) {
+        console_puts(buses[i]->prompt);
+        print_stat(" bytes", stats.bus_bytes[i]);
+    }
+    print_stat("SPI wait cycles", stats.spi_wait);
+    print_stat("UART TX bytes", stats.uart_tx_bytes);
+    print_stat("TX stall cycles", uart_tx_stall_cycles);
+    print_stat("RX overruns", uart_rx_overflows);
+    print_stat("Parse cycles", stats.parse);
+    print_stat("Run cycles", stats.run);
+    print_stat("Commands", stats.commands);
+    print_stat("Max command cycles", stats.command_max);
+}
+#endif
+
+#if CONFIG_FLASH
+static const uint8_t *skip_spaces(const uint8_t *s)
+{
+    while (*s == ' ')
+        s++;
     return s;
 }
 
+/*
+ * flash read <addr> <len> [fast] [crc]
+ * flash erase <addr> <len>
+ * flash write <addr> "<hex>"
+ */
+static void eval_flash_command(const uint8_t *s)
+{
+    uint32_t addr, len;
+
+    if (current_bus != &spi_bus)
+        set_bus(BUS_SPI);
+
+    if (match(s, "read ")) {
+        BOOL fast = FALSE, crc_only = FALSE;
+        s = parse_number_str32(skip_spaces(s + 5), &addr);
+        s = parse_number_str32(skip_spaces(s), &len);
+        while (*(s = skip_spaces(s))) {
+            if (match(s, "fast")) {
+                fast = TRUE;
+                s += 4;
+            } else if (match(s, "crc")) {
+                crc_only = TRUE;
+                s += 3;
+            } else {
+                syntax_error();
+                return;
+            }
+        }
+        flash_read(addr, len, fast, crc_only);
+    } else if (match(s, "erase ")) {
+        s = parse_number_str32(skip_spaces(s + 6), &addr);
+        s = parse_number_str32(skip_spaces(s), &len);
+        // Missing length parses as 0, don't guess which sector is meant
+        if (*skip_spaces(s) || !len) {
+            syntax_error();
+            return;
+        }
+        flash_erase(addr, len);
+    } else if (match(s, "write ")) {
+        s = parse_number_str32(skip_spaces(s + 6), &addr);
+        s = skip_spaces(s);
+        if (*s != '"') {
+            syntax_error();
+            return;
+        }
+        flash_write_begin(addr);
+        eval_bus_commands(start_payload(s + 1, PAYLOAD_FLASH));
+        console_endline();
+    } else {
+        syntax_error();
+    }
+}
+#endif
+
 void shell_eval(const uint8_t *s, uint16_t len)
 {
+#if CONFIG_PAYLOAD
+    // Continuation of w"..." from previous line
+    if (payload_open) {
+        s = eval_payload(s);
+        eval_bus_commands(s);
+        console_endline();
+        return;
+    }
+#endif
+
     // Process directives (start at the beginning of line, take whole line)
     if (match(s, "echo o")) {
         console_echo = TRUE;
         if (s[6] == 'f')
             console_echo = FALSE;
         return;
+#if CONFIG_OUTFMT
+    } else if (match(s, "out ")) {
+        // out verbose|hex|packed|raw [quiet]
+        switch (s[4]) {
+        case 'v':
+            console_out = OUT_VERBOSE;
+            break;
+        case 'h':
+            console_out = OUT_HEX;
+            break;
+        case 'p':
+            console_out = OUT_PACKED;
+            break;
+        case 'r':
+            console_out = OUT_RAW;
+            break;
+        default:
+            syntax_error();
+            return;
+        }
+        s += 4;
+        while (*s && *s != ' ')
+            s++;
+        console_quiet = match(s, " q");
+        return;
+#endif
     } else if (match(s, "spi")) {
+#if CONFIG_SPI_CONFIG
+        if (s[3] == ' ') {
+            eval_spi_config(s + 3);
+            return;
+        }
+#endif
         set_bus(BUS_SPI);
         return;
     } else if (match(s, "hiz")) {
         set_bus(BUS_HIZ);
         return;
+#if CONFIG_I2C
+    } else if (match(s, "i2c")) {
+        eval_i2c_config(s + 3);
+        return;
+#endif
+#if CONFIG_CAPTURE
+    } else if (match(s, "capture")) {
+        eval_capture_command(s + 7);
+        return;
+#endif
+#if CONFIG_EDGES
+    } else if (match(s, "edges")) {
+        eval_edges_command(s + 5);
+        return;
+    } else if (match(s, "dump")) {
+        edges_dump();
+        return;
+#endif
+#if CONFIG_SNIFF
+    } else if (match(s, "sniff")) {
+        eval_sniff_config(s + 5);
+        return;
+#endif
+#if CONFIG_BBSPI
+    } else if (match(s, "bbspi")) {
+        eval_bbspi_config(s + 5);
+        return;
+#endif
+#if CONFIG_FLASH
+    } else if (match(s, "flash ")) {
+        eval_flash_command(s + 6);
+        return;
+#endif
+#if CONFIG_MACRO
+    } else if (match(s, "macro")) {
+        eval_macro_command(s + 5);
+        return;
+#endif
+#if CONFIG_STATS
+    } else if (match(s, "stats")) {
+        if (match(s + 5, " reset"))
+            stats_reset();
+        else
+            print_stats();
+        return;
+#endif
+#if CONFIG_BBSPI || CONFIG_STATS
+    } else if (match(s, "bench")) {
+        eval_bench(s + 5);
+        return;
+#endif
+#if CONFIG_BAUD
+    } else if (match(s, "baud ")) {
+        uint32_t baud;
+        if (*parse_number_str32(s + 5, &baud) || !uart_set_baud(baud)) {
+            syntax_error();
+            return;
+        }
+        // Reply at the new rate
+        console_puts("BAUD: ");
+        console_putdec(baud);
+        console_newline();
+        return;
+#endif
+#if CONFIG_BINMODE
+    } else if (match(s, "binmode")) {
+        shell_binmode();
+        return;
+#endif
     } else if (match(s, "peek")) {
         uint16_t addr;
         parse_number_str(s + 5, &addr);
-        bus_dump_read(*(uint8_t*)addr);
+        bus_dump_read(*(uint8_t *)(uintptr_t)addr);
+        console_endline();
         return;
     } else {
         // No directive - process bus commands
         eval_bus_commands(s);
+        console_endline();
     }
 }
@@ -20,6 +20,8 @@
 
 void shell_init(void);
 void shell_eval(const uint8_t *str, uint16_t len);
+void shell_binmode(void);
+void shell_bus_tick(void);
 
 #endif
 
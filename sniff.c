@@ -0,0 +1,183 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * Passive SPI sniffer: USI in slave mode listens on SCLK (P1.5) and
+ * SDI (P1.7, MOSI of the target) without driving anything, CS (P1.4)
+ * pin-change interrupts mark frames. ISRs only queue bytes and markers
+ * into a RAM ring, the bus tick streams them out in current output
+ * format ("[" and "]" around frames, "!" where entries were lost)
+ * while buffering goes on. Clock mode and bit order are the "spi" ones.
+ *
+ * USI has no receive buffer, it's reloaded in the ISR, so back to back
+ * bytes are only caught at SCLK up to around MCLK/24.
+ *
+ * Bytes are 8-bit shifts (no USI16B: 16-bit frames split into bytes just
+ * as well, and it would halve the time to rearm). A missed or spurious
+ * SCLK edge shifts the rest of the frame, which only shows at CS
+ * deassert as a partial byte: such frames are marked "?" before "]".
+ * Frames whose length isn't a multiple of 8 bits are marked too.
+ */
+#include "common.h"
+#include "sniff.h"
+#include "spi.h"
+#include "console.h"
+#include "event.h"
+#include "stats.h"
+#include "capture.h"
+
+#if CONFIG_SNIFF
+
+static struct {
+    volatile uint8_t head, tail;
+    uint16_t buf[SNIFF_BUF_SIZ];
+} ring;
+static volatile uint16_t lost; // SNIFF_LOST if next entry follows a gap
+BOOL sniff_active;
+
+static void sniff_put(uint16_t e)
+{
+    if ((uint8_t)(ring.head - ring.tail) == SNIFF_BUF_SIZ) {
+        lost = SNIFF_LOST;
+        return;
+    }
+    ring.buf[ring.head & (SNIFF_BUF_SIZ - 1)] = e | lost;
+    ring.head++;
+    lost = 0;
+}
+
+interrupt(USI_VECTOR) USI_ISR(void)
+{
+    uint8_t c = USISRL;
+
+    // Rearm right away, next byte may already be coming
+    USICNT = 8;
+    sniff_put(c);
+    event_post_isr(EV_BUS);
+}
+
+// CS pin-change interrupt handler, see main.c
+void sniff_cs_irq(void)
+{
+    if (!(P1IE & P1IFG & CS))
+        return;
+    P1IFG &= ~CS;
+    // Next edge is the opposite of current level
+    if (P1IN & CS) {
+        uint8_t cnt = USICNT & 0x1F;
+
+        P1IES |= CS;
+        // 0: last byte is complete, but USI ISR hasn't taken it yet. Take
+        // it here (rearming clears USIIFG), so it stays inside the frame.
+        if (!cnt) {
+            sniff_put(USISRL);
+            USICNT = 8;
+            cnt = 8;
+        }
+        // Otherwise 8 if no bits came since last byte
+        sniff_put(SNIFF_END | (cnt != 8 ? SNIFF_BAD : 0));
+    } else {
+        P1IES &= ~CS;
+        // Frame starts at byte boundary, whatever came before
+        USICNT = 8;
+        sniff_put(SNIFF_START);
+    }
+    event_post_isr(EV_BUS);
+}
+
+static void sniff_init(void)
+{
+    P1DIR &= ~(SCLK | SDO | SDI | CS);
+
+    // SCLK and SDI only, slave, never drive SDO
+    USICTL0 = USIPE7 | USIPE5 | USISWRST;
+    if (spi_lsb)
+        USICTL0 |= USILSB;
+    USICTL1 = ((spi_mode & 1) ? 0 : USICKPH) | USIIE;
+    USICKCTL = (spi_mode & 2) ? USICKPL : 0;
+
+    ring.head = ring.tail = 0;
+    lost = 0;
+
+#if CONFIG_EDGES
+    // Both would rewrite CS flags and edge select
+    edges_drop(&P1IN, CS);
+#endif
+    sniff_active = TRUE;
+    P1IES = (P1IES & ~CS) | (P1IN & CS);
+    P1IFG &= ~CS;
+    P1IE |= CS;
+    USICTL0 &= ~USISWRST;
+    USICNT = 8;
+}
+
+static void sniff_exit(void)
+{
+    sniff_active = FALSE;
+    P1IE &= ~CS;
+    USICTL0 = USISWRST;
+    USICTL1 = 0;
+}
+
+// Output entries queued so far, later ones come with next EV_BUS
+static void sniff_tick(void)
+{
+    uint8_t n = ring.head - ring.tail;
+    uint16_t e;
+
+    while (n--) {
+        e = ring.buf[ring.tail & (SNIFF_BUF_SIZ - 1)];
+        ring.tail++;
+        if (console_out != OUT_RAW && (e & SNIFF_LOST))
+            console_putmark('!');
+        if (e & SNIFF_START) {
+            if (console_out != OUT_RAW)
+                console_putmark('[');
+        } else if (e & SNIFF_END) {
+            if (console_out != OUT_RAW) {
+                if (e & SNIFF_BAD)
+                    console_putmark('?');
+                console_putmark(']');
+                console_endline();
+            }
+        } else {
+            console_putdata(e);
+#if CONFIG_STATS
+            stats.bus_bytes[BUS_SNIFF]++;
+#endif
+        }
+    }
+}
+
+static void sniff_nop(void)
+{
+}
+
+static uint8_t sniff_xact(uint8_t c)
+{
+    return 0;
+}
+
+struct Bus sniff_bus = {
+    .prompt = "SNIFF",
+    .init = sniff_init,
+    .exit = sniff_exit,
+    .start = sniff_nop,
+    .stop = sniff_nop,
+    .xact = sniff_xact,
+    .tick = sniff_tick,
+};
+
+#endif
@@ -0,0 +1,34 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef SNIFF_H
+#define SNIFF_H 1
+
+#include "common.h"
+#include "bus.h"
+
+extern struct Bus sniff_bus;
+// Sniffer is the current bus, and owns CS pin-change interrupt
+extern BOOL sniff_active;
+
+// Ring buffer entries: data byte, or frame marker, with flags
+#define SNIFF_START     0x0100  // CS asserted
+#define SNIFF_END       0x0200  // CS deasserted
+#define SNIFF_BAD       0x4000  // frame ended mid-byte, bits misaligned
+#define SNIFF_LOST      0x8000  // entries were lost before this one
+
+void sniff_cs_irq(void);
+
+#endif
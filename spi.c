@@ -14,46 +14,74 @@
 * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 */
 #include "spi.h"
+#include "stats.h"
 
+// 0 is SMCLK / 128 (~7.8KHz at 1MHz), mode 0, MSB first by default
+uint32_t spi_speed;
+uint8_t spi_mode;
+BOOL spi_lsb;
+
+static BOOL active;
+
+#ifdef __MSP430_HAS_USI__
+
+// Program clock, mode and bit order, doesn't touch CS.
+// Returns actual SCLK frequency.
+uint32_t spi_configure(void)
+{
+    uint8_t div = 0;
+
+    // Divider is a power of 2, up to 128
+    if (!spi_speed)
+        div = 7;
+    while (div < 7 && (cpu_hz >> div) > spi_speed)
+        div++;
+
+    if (active) {
+        USICTL0 |= USISWRST;
+
+        if (spi_lsb)
+            USICTL0 |= USILSB;
+        else
+            USICTL0 &= ~USILSB;
+
+        // SMCLK / 2^div, clock polarity
+        USICKCTL = (div << 5) | USISSEL_2 | ((spi_mode & 2) ? USICKPL : 0);
+
+        // USI clock phase bit is inverse of CPHA
+        USICTL1 = (spi_mode & 1) ? 0 : USICKPH;
+
+        // release from reset
+        USICTL0 &= ~USISWRST;
+    }
+    return cpu_hz >> div;
+}
 
 void spi_init(void)
 {
     P1DIR |= SCLK | SDO | CS;
     P1DIR &= ~SDI;
 
-    // enable SDI, SDO, SCLK, master mode, MSB, output enabled, hold in reset
+    // enable SDI, SDO, SCLK, master mode, output enabled, hold in reset
     USICTL0 = USIPE7 | USIPE6 | USIPE5 | USIMST | USIOE | USISWRST;
 
-    // SMCLK / 128 = ~7.8KHz
-    USICKCTL = USISSEL_2 | USIDIV_7;
-
-    // clock phase
-    USICTL1 |= USICKPH;
-
-    // release from reset
-    USICTL0 &= ~USISWRST;
+    active = TRUE;
+    spi_configure();
 }
 
 void spi_exit(void)
 {
+    active = FALSE;
     USICTL0 = USISWRST;
     P1DIR &= ~(SCLK | SDO | CS | SDI);
 }
 
-void spi_cs_assert(void)
-{
-    // assert CS
-    P1OUT &= ~CS;
-}
-
-void spi_cs_deassert(void)
-{
-    // deassert CS
-    P1OUT |= CS;
-}
-
 uint8_t spi_write8(uint8_t c)
 {
+#if CONFIG_STATS
+    uint16_t t = cpu_ticks();
+#endif
+
     USISRL = c;
     // clear interrupt flag
     USICTL1 &= ~USIIFG;
@@ -63,11 +91,143 @@ uint8_t spi_write8(uint8_t c)
     // wait for tx
     while(!(USICTL1 & USIIFG));
 
+#if CONFIG_STATS
+    stats.spi_wait += (uint16_t)(cpu_ticks() - t);
+    stats.bus_bytes[BUS_SPI]++;
+#endif
     c = USISRL;
 
     return c;
 }
 
+uint16_t spi_xact_bits(uint16_t c, uint8_t bits)
+{
+#if CONFIG_STATS
+    uint16_t t = cpu_ticks();
+#endif
+
+    // 16-bit shift register goes out from bit 15 (MSB first) or bit 0,
+    // and comes in at the other end
+    if (!spi_lsb)
+        c <<= 16 - bits;
+    USISR = c;
+    USICTL1 &= ~USIIFG;
+    USICNT = USI16B | bits;
+
+    while(!(USICTL1 & USIIFG));
+
+#if CONFIG_STATS
+    stats.spi_wait += (uint16_t)(cpu_ticks() - t);
+    stats.bus_bytes[BUS_SPI] += (bits + 7) / 8;
+#endif
+    c = USISR;
+    if (spi_lsb)
+        return c >> (16 - bits);
+    return c & (0xFFFF >> (16 - bits));
+}
+
+// Any width from 1 to 16 bits
+#define SPI_WIDTHS 0xFFFF
+
+#else
+
+// Parts without USI (G2553 & co) - use USCI_B0
+
+// Program clock, mode and bit order, doesn't touch CS.
+// Returns actual SCLK frequency.
+uint32_t spi_configure(void)
+{
+    uint32_t div = spi_speed ? (cpu_hz + spi_speed - 1) / spi_speed : 128;
+
+    if (div == 0)
+        div = 1;
+    else if (div > 0xFFFF)
+        div = 0xFFFF;
+
+    if (active) {
+        UCB0CTL1 = UCSSEL_2 | UCSWRST;
+
+        // master, 3-pin SPI; USCI clock phase bit is inverse of CPHA
+        UCB0CTL0 = UCMST | UCSYNC
+            | ((spi_mode & 1) ? 0 : UCCKPH)
+            | ((spi_mode & 2) ? UCCKPL : 0)
+            | (spi_lsb ? 0 : UCMSB);
+
+        UCB0BR0 = div;
+        UCB0BR1 = div >> 8;
+
+        // release from reset
+        UCB0CTL1 &= ~UCSWRST;
+    }
+    return cpu_hz / div;
+}
+
+void spi_init(void)
+{
+    P1DIR |= CS;
+    P1SEL |= SCLK | SDO | SDI;
+    P1SEL2 |= SCLK | SDO | SDI;
+
+    active = TRUE;
+    spi_configure();
+}
+
+void spi_exit(void)
+{
+    active = FALSE;
+    UCB0CTL1 = UCSWRST;
+    P1SEL &= ~(SCLK | SDO | SDI);
+    P1SEL2 &= ~(SCLK | SDO | SDI);
+    P1DIR &= ~(SCLK | SDO | CS | SDI);
+}
+
+uint8_t spi_write8(uint8_t c)
+{
+#if CONFIG_STATS
+    uint16_t t = cpu_ticks();
+#endif
+
+    UCB0TXBUF = c;
+
+    // wait for rx of the byte clocked in
+    while(!(IFG2 & UCB0RXIFG));
+
+#if CONFIG_STATS
+    stats.spi_wait += (uint16_t)(cpu_ticks() - t);
+    stats.bus_bytes[BUS_SPI]++;
+#endif
+    return UCB0RXBUF;
+}
+
+// USCI only does 8-bit characters, so 16 bits are two of them
+uint16_t spi_xact_bits(uint16_t c, uint8_t bits)
+{
+    uint16_t r;
+
+    if (spi_lsb) {
+        r = spi_write8(c);
+        return r | (uint16_t)spi_write8(c >> 8) << 8;
+    }
+    r = (uint16_t)spi_write8(c >> 8) << 8;
+    return r | spi_write8(c);
+}
+
+#define SPI_WIDTHS 0x8080
+
+#endif
+
+void spi_cs_assert(void)
+{
+    // assert CS
+    P1OUT &= ~CS;
+}
+
+void spi_cs_deassert(void)
+{
+    // deassert CS
+    P1OUT |= CS;
+}
+
 struct Bus spi_bus = {
     .prompt = "SPI",
     .init = spi_init,
@@ -75,4 +235,6 @@ struct Bus spi_bus = {
     .start = spi_cs_assert,
     .stop = spi_cs_deassert,
     .xact = spi_write8,
+    .xact_bits = spi_xact_bits,
+    .widths = SPI_WIDTHS,
 };
@@ -18,13 +18,28 @@
 
 #include "common.h"
 #include "bus.h"
+#include "cpu.h"
 
 #define SCLK    BIT5
+#ifdef __MSP430_HAS_USI__
 #define SDI     BIT7
 #define SDO     BIT6
+#else
+// USCI_B0 has MISO/MOSI the other way around
+#define SDI     BIT6
+#define SDO     BIT7
+#endif
 #define CS      BIT4
 
 extern struct Bus spi_bus;
 
+// Settings applied by spi_init()/spi_configure(). Speed 0 is SMCLK/128,
+// mode is the usual (CPOL << 1) | CPHA.
+extern uint32_t spi_speed;
+extern uint8_t spi_mode;
+extern BOOL spi_lsb;
+
+uint32_t spi_configure(void);
+
 #endif
 
@@ -0,0 +1,36 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#include "common.h"
+#include "uart.h"
+#include "stats.h"
+#include <string.h>
+
+struct Stats stats;
+
+void stats_reset(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    uart_rx_overflows = 0;
+    uart_tx_stall_cycles = 0;
+}
+
+// Account one command line that took given number of cycles
+void stats_command(uint32_t cycles)
+{
+    stats.commands++;
+    if (cycles > stats.command_max)
+        stats.command_max = cycles;
+}
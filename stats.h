@@ -0,0 +1,40 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef STATS_H
+#define STATS_H 1
+
+#include "common.h"
+
+/*
+ * Performance counters shown by "stats" command. Times are in SMCLK
+ * cycles (see cpu_ticks()).
+ */
+struct Stats {
+    uint32_t bus_bytes[BUS_COUNT];  // bytes transferred on each bus
+    uint32_t spi_wait;              // waiting for SPI transfers to finish
+    uint32_t uart_tx_bytes;
+    uint32_t parse;                 // checking and compiling bus commands
+    uint32_t run;                   // running them
+    uint32_t commands;              // lines handled
+    uint32_t command_max;           // longest line, receipt to prompt
+};
+
+extern struct Stats stats;
+
+void stats_reset(void);
+void stats_command(uint32_t cycles);
+
+#endif
@@ -1,122 +1,155 @@
 #include "uart.h"
+#include "fifo.h"
+#include "cpu.h"
+#include "stats.h"
+#include "event.h"
 /* Originally version from:
 http://www.msp430launchpad.com/2010/08/half-duplex-software-uart-on-launchpad.html
+Receive was moved from PORT1 interrupt to Timer_A CCR1 capture on P1.2
+(CCI1A), like in TI's msp430g2xx1_ta_uart9600.c example, so TX (CCR0) and
+RX can now work at the same time.
 */
 
 /****************************************************************/
 
+// Shortest bit time (in SMCLK cycles) the ISRs below can keep up with
+#define MIN_BIT_TIME 48
+
+static uint16_t bit_time; // in SMCLK cycles
+static uint16_t half_bit_time;
+
 static volatile uint8_t bitCount; // Bit count, used when transmitting byte
-static volatile unsigned int TXByte; // Value sent over UART when uart_putc() is called
-static volatile unsigned int RXByte; // Value recieved once hasRecieved is set
+static volatile unsigned int TXByte; // Byte being sent, with start/stop bits
 
-static volatile BOOL isReceiving = FALSE; // Status for when the device is receiving
-static volatile BOOL hasReceived = FALSE; // Lets the program know when a byte is received
+static FIFO(rx_fifo, UART_RX_BUF_SIZ);
+static FIFO(tx_fifo, UART_TX_BUF_SIZ);
+volatile uint16_t uart_rx_overflows;
+uint32_t uart_tx_stall_cycles;
 
 /****************************************************************/
 void uart_init(void)
 {
-    P1SEL |= TXD;
+    P1SEL |= TXD | RXD;
     P1DIR |= TXD;
+    P1DIR &= ~RXD;
 
-    P1IES |= RXD; // RXD Hi/lo edge interrupt
-    P1IFG &= ~RXD; // Clear RXD (flag) before enabling interrupt
-    P1IE |= RXD; // Enable RXD interrupt
+    CCTL0 = OUT; // TXD Idle as Mark
+    CCTL1 = SCS + CM1 + CAP + CCIE; // Sync, falling edge, capture, interrupt
+    // Timer itself is started by cpu_init()
+    uart_set_baud(BAUDRATE);
 }
 
-BOOL uart_getc(uint8_t *c)
+// Wait until everything queued is sent
+void uart_flush(void)
 {
-    if (!hasReceived)
-        return FALSE;
-    *c = RXByte;
-    hasReceived = FALSE;
-    return TRUE;
+    while (CCTL0 & CCIE);
 }
 
-void uart_putc(uint8_t c)
+BOOL uart_set_baud(uint32_t baud)
 {
-    TXByte = c;
-
-    while(isReceiving); // Wait for RX completion
-
-    CCTL0 = OUT; // TXD Idle as Mark
-    TACTL = TASSEL_2 + MC_2; // SMCLK, continuous mode
-
-    bitCount = 0xA; // Load Bit counter, 8 bits + ST/SP
-    CCR0 = TAR; // Initialize compare register
+    uint32_t t;
 
-    CCR0 += BIT_TIME; // Set time till first bit
-    TXByte |= 0x100; // Add stop bit to TXByte (which is logical 1)
-    TXByte = TXByte << 1; // Add start bit (which is logical 0)
-
-    CCTL0 = CCIS0 + OUTMOD0 + CCIE; // Set signal, intial value, enable interrupts
-
-    while ( CCTL0 & CCIE ); // Wait for previous TX completion
+    if (!baud)
+        return FALSE;
+    t = cpu_hz / baud;
+    if (t < MIN_BIT_TIME || t > 0xFFFF)
+        return FALSE;
+    uart_flush();
+    bit_time = t;
+    half_bit_time = t / 2;
+    return TRUE;
 }
 
-interrupt(PORT1_VECTOR) PORT1_ISR(void)
+BOOL uart_getc(uint8_t *c)
 {
-    isReceiving = TRUE;
-
-    P1IE &= ~RXD; // Disable RXD interrupt
-    P1IFG &= ~RXD; // Clear RXD IFG (interrupt flag)
+    if (FIFO_EMPTY(rx_fifo))
+        return FALSE;
+    *c = FIFO_GET(rx_fifo);
+    return TRUE;
+}
 
-    TACTL = TASSEL_2 + MC_2; // SMCLK, continuous mode
-    CCR0 = TAR; // Initialize compare register
-    CCR0 += HALF_BIT_TIME; // Set time till first bit
-    CCTL0 = OUTMOD1 + CCIE; // Disable TX and enable interrupts
+void uart_putc(uint8_t c)
+{
+#if CONFIG_STATS
+    stats.uart_tx_bytes++;
+#endif
+    if (FIFO_FULL(tx_fifo)) {
+        uint16_t t = cpu_ticks();
+        while (FIFO_FULL(tx_fifo));
+        uart_tx_stall_cycles += (uint16_t)(cpu_ticks() - t);
+    }
 
-    RXByte = 0; // Initialize RXByte
-    bitCount = 9; // Load Bit counter, 8 bits + start bit
+    dint();
+    FIFO_PUT(tx_fifo, c);
+    if (!(CCTL0 & CCIE)) // Transmitter idle, kick it
+    {
+        bitCount = 0; // ISR will fetch byte from FIFO
+        CCR0 = TAR; // Initialize compare register
+        CCR0 += bit_time; // Set time till first bit
+        CCTL0 = OUTMOD0 + CCIE; // Set signal, intial value, enable interrupts
+    }
+    eint();
 }
 
 interrupt(TIMERA0_VECTOR) TIMERA0_ISR(void)
 {
-    if(!isReceiving)
+    CCR0 += bit_time; // Add Offset to CCR0
+    if ( bitCount == 0) // If all bits TXed
     {
-        CCR0 += BIT_TIME; // Add Offset to CCR0
-        if ( bitCount == 0) // If all bits TXed
+        if (FIFO_EMPTY(tx_fifo))
         {
-            TACTL = TASSEL_2; // SMCLK, timer off (for power consumption)
             CCTL0 &= ~ CCIE ; // Disable interrupt
+            return;
         }
-        else
-        {
-            CCTL0 |= OUTMOD2; // Set TX bit to 0
-            if (TXByte & 0x01)
-                CCTL0 &= ~ OUTMOD2; // If it should be 1, set it to 1
-            TXByte = TXByte >> 1;
-            bitCount --;
-        }
+        // Next byte follows right after the stop bit
+        TXByte = FIFO_GET(tx_fifo);
+        TXByte |= 0x100; // Add stop bit to TXByte (which is logical 1)
+        TXByte = TXByte << 1; // Add start bit (which is logical 0)
+        bitCount = 0xA; // Load Bit counter, 8 bits + ST/SP
     }
-    else
-    {
-        CCR0 += BIT_TIME; // Add Offset to CCR0
-        if ( bitCount == 0)
-        {
-            TACTL = TASSEL_2; // SMCLK, timer off (for power consumption)
-            CCTL0 &= ~ CCIE ; // Disable interrupt
 
-            isReceiving = FALSE;
+    CCTL0 |= OUTMOD2; // Set TX bit to 0
+    if (TXByte & 0x01)
+        CCTL0 &= ~ OUTMOD2; // If it should be 1, set it to 1
+    TXByte = TXByte >> 1;
+    bitCount --;
+}
 
-            P1IFG &= ~RXD; // clear RXD IFG (interrupt flag)
-            P1IE |= RXD; // enabled RXD interrupt
+interrupt(TIMERA1_VECTOR) TIMERA1_ISR(void)
+{
+    static uint8_t rxBitCount;
+    static uint8_t rxByte;
+
+    switch (TAIV) {
+    case 2: // CCR1
+        break;
+    case 10: // TAIFG, see cpu_ticks32()
+        cpu_ticks_hi++;
+        return;
+    default:
+        return;
+    }
 
-            if ( (RXByte & 0x201) == 0x200) // Validate the start and stop bits are correct
-            {
-                RXByte = RXByte >> 1; // Remove start bit
-                RXByte &= 0xFF; // Remove stop bit
-                hasReceived = TRUE;
-            }
-        }
-        else
+    CCR1 += bit_time; // Add Offset to CCR1
+    if (CCTL1 & CAP) // Start bit edge captured
+    {
+        CCTL1 &= ~CAP; // Switch to compare mode
+        CCR1 += half_bit_time; // Sample in the middle of D0
+        rxBitCount = 8;
+    }
+    else
+    {
+        rxByte = rxByte >> 1;
+        if (CCTL1 & SCCI) // Bit latched at compare
+            rxByte |= 0x80;
+        if (--rxBitCount == 0)
         {
-            if ( (P1IN & RXD) == RXD) // If bit is set?
-                RXByte |= 0x400; // Set the value in the RXByte
-            RXByte = RXByte >> 1; // Shift the bits down
-            bitCount --;
+            if (FIFO_FULL(rx_fifo))
+                uart_rx_overflows++;
+            else
+                FIFO_PUT(rx_fifo, rxByte);
+            CCTL1 |= CAP; // Wait for next start bit
+            event_post_isr(EV_UART_RX);
         }
     }
 }
-
-
-
@@ -2,19 +2,28 @@
 #define UART_H 1
 
 #include "common.h"
+#include "cpu.h"
 
+#ifdef UART_USCI
+#define TXD BIT2 // UCA0TXD on P1.2
+#define RXD BIT1 // UCA0RXD on P1.1
+#else
 #define TXD BIT1 // TXD on P1.1
 #define RXD BIT2 // RXD on P1.2
+#endif
 
-#define FCPU 1000000
 #define BAUDRATE 9600
 
-#define BIT_TIME        (FCPU / BAUDRATE)
-#define HALF_BIT_TIME   (BIT_TIME / 2)
-
 void uart_init(void);
 BOOL uart_getc(uint8_t *c);
 void uart_putc(uint8_t c);
+void uart_flush(void);
+BOOL uart_set_baud(uint32_t baud);
+
+// Bytes lost because receive FIFO was full
+extern volatile uint16_t uart_rx_overflows;
+// SMCLK cycles uart_putc() spent waiting for room in transmit FIFO
+extern uint32_t uart_tx_stall_cycles;
 
 #endif
 
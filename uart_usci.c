@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2012, Toby Jaffey <spiexplorer@hodgepig.org>
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+* WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+* MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+* ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+* WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+* ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+* OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+/*
+ * Hardware UART on USCI_A0 (MSP430G2553 and similar). Unlike the soft
+ * UART, this one is full duplex and can go as fast as SMCLK / 3.
+ * Note that Launchpad's TXD/RXD jumpers have to be set for hardware
+ * UART (crossed compared to soft UART).
+ */
+#include "uart.h"
+#include "fifo.h"
+#include "cpu.h"
+#include "stats.h"
+#include "event.h"
+
+static FIFO(rx_fifo, UART_RX_BUF_SIZ);
+static FIFO(tx_fifo, UART_TX_BUF_SIZ);
+volatile uint16_t uart_rx_overflows;
+uint32_t uart_tx_stall_cycles;
+
+void uart_init(void)
+{
+    P1SEL |= TXD | RXD;
+    P1SEL2 |= TXD | RXD;
+
+    UCA0CTL1 = UCSSEL_2 | UCSWRST; // SMCLK, hold in reset
+    UCA0CTL0 = 0; // 8-N-1
+    uart_set_baud(BAUDRATE);
+}
+
+// Wait until everything queued is sent
+void uart_flush(void)
+{
+    while (IE2 & UCA0TXIE);
+    while (UCA0STAT & UCBUSY);
+}
+
+BOOL uart_set_baud(uint32_t baud)
+{
+    // Low-frequency mode: UCBRx = int(N), UCBRSx = round(frac(N) * 8),
+    // where N = SMCLK / baud
+    uint32_t n8;
+
+    if (!baud)
+        return FALSE;
+    n8 = (cpu_hz * 8 + baud / 2) / baud;
+    if (n8 < 3 * 8 || n8 > 0xFFFF * 8)
+        return FALSE;
+
+    uart_flush();
+    UCA0CTL1 |= UCSWRST;
+    UCA0BR0 = n8 >> 3;
+    UCA0BR1 = n8 >> 11;
+    UCA0MCTL = (n8 & 7) * UCBRS0;
+    UCA0CTL1 &= ~UCSWRST;
+    IE2 |= UCA0RXIE; // reset clears them
+    return TRUE;
+}
+
+BOOL uart_getc(uint8_t *c)
+{
+    if (FIFO_EMPTY(rx_fifo))
+        return FALSE;
+    *c = FIFO_GET(rx_fifo);
+    return TRUE;
+}
+
+void uart_putc(uint8_t c)
+{
+#if CONFIG_STATS
+    stats.uart_tx_bytes++;
+#endif
+    if (FIFO_FULL(tx_fifo)) {
+        uint16_t t = cpu_ticks();
+        while (FIFO_FULL(tx_fifo));
+        uart_tx_stall_cycles += (uint16_t)(cpu_ticks() - t);
+    }
+
+    FIFO_PUT(tx_fifo, c);
+    // TX ISR runs as long as there's something in FIFO
+    IE2 |= UCA0TXIE;
+}
+
+interrupt(USCIAB0RX_VECTOR) USCIAB0RX_ISR(void)
+{
+    // Byte lost in hardware counts as overflow too
+    if (UCA0STAT & UCOE)
+        uart_rx_overflows++;
+    if (FIFO_FULL(rx_fifo)) {
+        uart_rx_overflows++;
+        (void)UCA0RXBUF;
+    } else {
+        FIFO_PUT(rx_fifo, UCA0RXBUF);
+    }
+    event_post_isr(EV_UART_RX);
+}
+
+interrupt(USCIAB0TX_VECTOR) USCIAB0TX_ISR(void)
+{
+    if (FIFO_EMPTY(tx_fifo))
+        IE2 &= ~UCA0TXIE;
+    else
+        UCA0TXBUF = FIFO_GET(tx_fifo);
+}